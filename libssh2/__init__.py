@@ -21,15 +21,23 @@ __doc__ = """Python binding for libssh2 library"""
 
 from version import *
 
+from _libssh2 import Error, WouldBlock
+from _libssh2 import SESSION_BLOCK_INBOUND, SESSION_BLOCK_OUTBOUND
+from _libssh2 import POLLFD_POLLIN, POLLFD_POLLEXT, POLLFD_POLLOUT
+from _libssh2 import POLLFD_SESSION_CLOSED, POLLFD_CHANNEL_CLOSED
+
 from channel import ChannelException, Channel
 from session import SessionException, Session
 from sftp import SftpException, Sftp
 from sftpfile import SftpFileException, SftpFile
 from sftpdir import SftpDirException, SftpDir
+from eventloop import EventLoop
 
 __all__ = [
     'Channel',
     'ChannelException',
+    'Error',
+    'EventLoop',
     'Session',
     'SessionException',
     'Sftp',
@@ -38,6 +46,7 @@ __all__ = [
     'SftpExceptionFile',
     'SftpDir',
     'SftpExceptionDir',
+    'WouldBlock',
 ]
 
 LIBSSH2_TRACE_TRANS = 1 << 1
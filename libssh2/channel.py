@@ -112,6 +112,29 @@ class Channel(object):
         else:
             return self._channel.poll_read()
 
+    def stream(self, on_stdout=None, on_stderr=None, chunk=65536):
+        """
+        Reads stdout and stderr until the command running on the channel
+        ends, waiting without the GIL and without polling from Python. The
+        callbacks get a memoryview over a buffer reused by the next call,
+        copy what must be kept. Data of a stream without callback is dropped.
+
+            channel.execute("make")
+            status = channel.stream(sys.stdout.write, sys.stderr.write)
+
+        @param on_stdout: called with the data read on stdout
+        @type on_stdout: callable
+        @param on_stderr: called with the data read on stderr
+        @type on_stderr: callable
+        @param chunk: size of the buffer
+        @type chunk: int
+
+        @return: exit status of the command
+        @rtype: int
+        """
+        logging.debug("Channel.stream")
+        return self._channel.stream(on_stdout, on_stderr, chunk)
+
     def pty(self, term="vt100"):
         """
         Requests a pty with term type on the channel.
@@ -156,15 +179,16 @@ class Channel(object):
         """
         logging.debug("Channel.read")
         if size == -1:
-            buf = ""
+            # extended in place, appending to a str copies it every read
+            buf = bytearray()
             while True:
                 try:
-                    new_buf = self._channel.read()
+                    new_buf = self._channel.read(65536)
                 except Exception:
                     new_buf = ""
 
                 if new_buf and len(new_buf) > 0:
-                    buf += new_buf
+                    buf.extend(new_buf)
                 else:
                     break
             return buf
@@ -187,6 +211,34 @@ class Channel(object):
         logging.debug("Channel.read_ex")
         return self._channel.read_ex(size, stream_id)
 
+    def readinto(self, buffer):
+        """
+        Reads on the channel directly into buffer without any copy.
+
+        @param buffer: writable buffer (bytearray, memoryview, mmap...)
+        @type buffer: buffer
+
+        @return: number of bytes read, 0 on end of file
+        @rtype: int
+        """
+        logging.debug("Channel.readinto")
+        return self._channel.readinto(buffer)
+
+    def read_ex_into(self, buffer, stream_id=0):
+        """
+        Reads on the channel stream_id directly into buffer without any copy.
+
+        @param buffer: writable buffer (bytearray, memoryview, mmap...)
+        @type buffer: buffer
+        @param stream_id: stream_id of the stream upon which to read
+        @type stream_id: int
+
+        @return: number of bytes read
+        @rtype: int
+        """
+        logging.debug("Channel.read_ex_into")
+        return self._channel.read_ex_into(buffer, stream_id)
+
     def send_eof(self):
         """
         Sends EOF status on the channel to remote server.
@@ -283,6 +335,20 @@ class Channel(object):
         logging.debug("Channel.write")
         return self._channel.write(message)
 
+    def stats(self):
+        """
+        Returns the counters of the reads and writes made on the channel.
+
+        @return: calls, bytes_read, bytes_written, eagain, errors and
+        blocked_ns, the time spent inside libssh2 in nanoseconds, and id,
+        the id of the object in the traces; window, the receive window left
+        to the peer, window_target, the window kept open, window_max, its
+        tuning limit or 0, and rtt_ns, the round trip used by the tuning
+        @rtype: dict
+        """
+        logging.debug("Channel.stats")
+        return self._channel.stats()
+
     def x11_req(self, single_connection, auth_proto, auth_cookie, display):
         """
         Requests a X11 Forwarding on the channel.
@@ -0,0 +1,185 @@
+#
+# pylibssh2 - python bindings for libssh2 library
+#
+# Copyright (C) 2010 Wallix Inc.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by the
+# Free Software Foundation; either version 2.1 of the License, or (at your
+# option) any later version.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+# details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+#
+from collections import deque
+from _libssh2 import WouldBlock, SESSION_BLOCK_INBOUND, SESSION_BLOCK_OUTBOUND
+import logging
+import select
+import sys
+import time
+"""
+Cooperative driver for non-blocking L{Session} objects.
+
+A task is a generator bound to a session. It yields the calls to make,
+either a callable or a (callable, arg, ...) tuple, and gets their result
+back. When a call raises L{WouldBlock}, the loop waits for the session
+socket to be ready in the directions reported by libssh2, then retries
+the same call. Exceptions are thrown back into the generator.
+
+    def uname(session):
+        channel = yield session.open_session
+        yield channel.execute, "uname -a"
+        output = yield channel.read, 4096
+
+    loop = EventLoop()
+    session.set_blocking(False)
+    loop.spawn(session, uname(session))
+    loop.run()
+"""
+
+
+class Task(object):
+    """
+    Generator driven by an L{EventLoop}.
+    """
+    def __init__(self, session, generator):
+        self.session = session
+        self.generator = generator
+        self.done = False
+        self.exc_info = None
+        self._call = None
+        self._value = None
+        self._error = None
+
+    def get(self):
+        """
+        Re-raises the exception that ended the task, if any.
+        """
+        if self.exc_info is not None:
+            raise self.exc_info[0], self.exc_info[1], self.exc_info[2]
+
+
+class EventLoop(object):
+    """
+    Runs L{Task} objects, sleeping in poll() (or select()) while all of
+    them are blocked on their session socket.
+    """
+    def __init__(self):
+        self._ready = deque()
+        # Task -> (fd, libssh2 block directions)
+        self._waiting = {}
+
+    def spawn(self, session, generator):
+        """
+        Schedules generator to run against session, which must have been
+        set non-blocking.
+
+        @return: the new task
+        @rtype: L{Task}
+        """
+        task = Task(session, generator)
+        self._ready.append(task)
+        return task
+
+    def run(self, timeout=None):
+        """
+        Runs until every task is done, or until timeout seconds elapsed.
+
+        @return: True if every task is done
+        @rtype: bool
+        """
+        deadline = None
+        if timeout is not None:
+            deadline = time.time() + timeout
+        while self._ready or self._waiting:
+            while self._ready:
+                self._step(self._ready.popleft())
+            if not self._waiting:
+                break
+            wait = None
+            if deadline is not None:
+                wait = deadline - time.time()
+                if wait <= 0:
+                    return False
+            self._wait(wait)
+        return True
+
+    def _step(self, task):
+        if task._call is None:
+            try:
+                if task._error is not None:
+                    error, task._error = task._error, None
+                    yielded = task.generator.throw(*error)
+                else:
+                    yielded = task.generator.send(task._value)
+            except StopIteration:
+                task.done = True
+                return
+            except Exception:
+                task.done = True
+                task.exc_info = sys.exc_info()
+                logging.debug("EventLoop task failed: %s" % (task.exc_info[1],))
+                return
+            if not isinstance(yielded, tuple):
+                yielded = (yielded,)
+            task._call = yielded
+            task._value = None
+
+        try:
+            task._value = task._call[0](*task._call[1:])
+        except WouldBlock, e:
+            directions = 0
+            if len(e.args) > 1:
+                directions = e.args[1]
+            self._waiting[task] = (task.session.fileno(), directions)
+            return
+        except Exception:
+            task._error = sys.exc_info()
+        task._call = None
+        # one call per turn keeps the tasks sharing the loop fair
+        self._ready.append(task)
+
+    def _events(self, directions):
+        # nothing reported means libssh2 is waiting for the peer
+        if directions & SESSION_BLOCK_OUTBOUND and not directions & SESSION_BLOCK_INBOUND:
+            return False, True
+        if directions & SESSION_BLOCK_OUTBOUND:
+            return True, True
+        return True, False
+
+    def _wait(self, timeout):
+        readers = set()
+        writers = set()
+        for fd, directions in self._waiting.itervalues():
+            read, write = self._events(directions)
+            if read:
+                readers.add(fd)
+            if write:
+                writers.add(fd)
+
+        if hasattr(select, "poll"):
+            poller = select.poll()
+            for fd in readers | writers:
+                mask = 0
+                if fd in readers:
+                    mask |= select.POLLIN | select.POLLPRI
+                if fd in writers:
+                    mask |= select.POLLOUT
+                poller.register(fd, mask)
+            if timeout is not None:
+                timeout = int(timeout * 1000)
+            ready = set(fd for fd, event in poller.poll(timeout))
+        else:
+            r, w, x = select.select(list(readers), list(writers), list(readers | writers), timeout)
+            ready = set(r) | set(w) | set(x)
+
+        for task, (fd, directions) in self._waiting.items():
+            if fd in ready:
+                del self._waiting[task]
+                self._ready.append(task)
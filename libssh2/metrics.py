@@ -0,0 +1,126 @@
+#
+# pylibssh2 - python bindings for libssh2 library
+#
+# Copyright (C) 2010 Wallix Inc.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by the
+# Free Software Foundation; either version 2.1 of the License, or (at your
+# option) any later version.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+# details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+#
+import _libssh2
+"""
+Latency histograms of the blocking libssh2 calls
+
+The native module records the duration of every blocking call in one
+log-linear histogram per operation (startup, auth, open_session, sftp_init,
+sftp_open, read, write, stat, readdir, metadata, exec, transfer), with
+buckets at most 1/16th wide. The pipelined SFTP calls, copy_to and the
+scp_*_fd transfers count as one transfer each, so that read and write only
+hold single calls. Recording is off until L{enable} is called.
+
+    metrics.enable()
+    ...
+    print metrics.percentile("read", 99)
+    print metrics.prometheus_text()
+"""
+
+# upper bounds, in seconds, of the buckets exported to Prometheus
+PROMETHEUS_BUCKETS = (0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                      0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0)
+
+
+def enable(enabled=True):
+    """
+    Starts or stops the recording of the histograms.
+
+    @return: previous state
+    @rtype: bool
+    """
+    return _libssh2.histograms_enable(enabled)
+
+
+def reset():
+    """
+    Empties every histogram.
+    """
+    _libssh2.histograms_reset()
+
+
+def histograms():
+    """
+    Returns a snapshot of the histograms.
+
+    @return: {operation: {'count', 'sum_ns', 'min_ns', 'max_ns', 'buckets'}},
+    buckets being the non-empty (lower_ns, upper_ns, count) in increasing order
+    @rtype: dict
+    """
+    return _libssh2.histograms()
+
+
+def percentile(operation, percent, snapshot=None):
+    """
+    Returns the duration under which percent of the calls of operation
+    completed, as the upper bound of the bucket it falls in.
+
+    @param operation: name of the operation, e.g. "read"
+    @type operation: str
+    @param percent: 0 to 100
+    @type percent: float
+    @param snapshot: result of L{histograms}, taken now when None
+    @type snapshot: dict
+
+    @return: duration in seconds, 0.0 when no call was recorded
+    @rtype: float
+    """
+    if snapshot is None:
+        snapshot = histograms()
+    histogram = snapshot[operation]
+    if not histogram["count"]:
+        return 0.0
+    rank = max(1, int(round(percent / 100.0 * histogram["count"])))
+    seen = 0
+    for lower, upper, count in histogram["buckets"]:
+        seen += count
+        if seen >= rank:
+            return min(upper, histogram["max_ns"]) / 1e9
+    return histogram["max_ns"] / 1e9
+
+
+def prometheus_text(prefix="libssh2", buckets=PROMETHEUS_BUCKETS, snapshot=None):
+    """
+    Formats the histograms in the Prometheus text exposition format, as
+    one <prefix>_call_duration_seconds histogram labelled by operation. A
+    native bucket is counted under the first bound not below its upper end.
+
+    @return: text to serve on a /metrics endpoint
+    @rtype: str
+    """
+    if snapshot is None:
+        snapshot = histograms()
+    name = prefix + "_call_duration_seconds"
+    lines = ["# HELP %s Duration of the blocking libssh2 calls." % name,
+             "# TYPE %s histogram" % name]
+    for operation in sorted(snapshot):
+        histogram = snapshot[operation]
+        native = histogram["buckets"]
+        index = 0
+        cumulative = 0
+        for bound in buckets:
+            while index < len(native) and native[index][1] <= bound * 1e9:
+                cumulative += native[index][2]
+                index += 1
+            lines.append('%s_bucket{op="%s",le="%s"} %d' % (name, operation, repr(bound), cumulative))
+        lines.append('%s_bucket{op="%s",le="+Inf"} %d' % (name, operation, histogram["count"]))
+        lines.append('%s_sum{op="%s"} %s' % (name, operation, repr(histogram["sum_ns"] / 1e9)))
+        lines.append('%s_count{op="%s"} %d' % (name, operation, histogram["count"]))
+    return "\n".join(lines) + "\n"
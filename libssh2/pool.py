@@ -0,0 +1,320 @@
+#
+# pylibssh2 - python bindings for libssh2 library
+#
+# Copyright (C) 2010 Wallix Inc.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by the
+# Free Software Foundation; either version 2.1 of the License, or (at your
+# option) any later version.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+# details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+#
+from contextlib import contextmanager
+from session import Session
+import _libssh2
+import errno
+import hashlib
+import logging
+import os
+import select
+import socket
+import threading
+import time
+"""
+Pool of authenticated L{Session} objects
+"""
+
+
+class SessionPoolException(Exception):
+    """
+    Exception raised when L{SessionPool} actions fails.
+    """
+    pass
+
+
+class _PooledSession(object):
+    """
+    Authenticated session kept by the pool, with its socket and lazily
+    opened SFTP channel.
+    """
+    def __init__(self, key, sock, session):
+        self.key = key
+        self.sock = sock
+        self.session = session
+        self.sftp = None
+        self.last_used = time.time()
+
+    def close(self):
+        try:
+            if self.sftp is not None:
+                self.session.sftp_shutdown(self.sftp)
+            self.session.close()
+        except Exception, e:
+            logging.debug("SessionPool close failed: %s" % (e,))
+        try:
+            self.sock.close()
+        except socket.error:
+            pass
+
+
+class SessionPool(object):
+    """
+    Keeps authenticated sessions per (host, port, username, credential)
+    so that short jobs skip the key exchange and authentication, and caps
+    the number of sessions in use per (host, port).
+
+        pool = SessionPool(max_per_host=8)
+        with pool.session("host", "user", privatekey="~/.ssh/id_rsa") as session:
+            session.scp_send_file("a", "/tmp/a")
+        with pool.sftp("host", "user") as sftp:
+            sftp.get("/tmp/a", "b")
+    """
+    def __init__(self, max_per_host=4, max_idle_per_key=4, idle_timeout=300,
+                 keepalive_interval=30, connect_timeout=None):
+        """
+        @param max_per_host: sessions handed out at once per (host, port)
+        @type max_per_host: int
+        @param max_idle_per_key: idle sessions kept per key
+        @type max_idle_per_key: int
+        @param idle_timeout: seconds after which an idle session is closed
+        @type idle_timeout: int
+        @param keepalive_interval: seconds of inactivity after which a
+        session is probed with a keepalive before being handed out
+        @type keepalive_interval: int
+        @param connect_timeout: timeout of the TCP connection, in seconds
+        @type connect_timeout: float
+        """
+        self.max_per_host = max_per_host
+        self.max_idle_per_key = max_idle_per_key
+        self.idle_timeout = idle_timeout
+        self.keepalive_interval = keepalive_interval
+        self.connect_timeout = connect_timeout
+        self._lock = threading.Lock()
+        # key -> list of idle _PooledSession, most recently used last
+        self._idle = {}
+        # id(Session) -> _PooledSession handed out
+        self._busy = {}
+        # (host, port) -> BoundedSemaphore
+        self._limits = {}
+
+    def _limit(self, host, port):
+        self._lock.acquire()
+        try:
+            limit = self._limits.get((host, port))
+            if limit is None:
+                limit = threading.BoundedSemaphore(self.max_per_host)
+                self._limits[(host, port)] = limit
+            return limit
+        finally:
+            self._lock.release()
+
+    def _key(self, host, port, username, privatekey, passphrase, password):
+        """
+        Sessions are only shared between callers giving the same
+        credential, the secret itself is kept hashed.
+        """
+        if privatekey:
+            credential = ("privatekey", privatekey,
+                          hashlib.sha256(passphrase or "").hexdigest())
+        elif password:
+            credential = ("password", hashlib.sha256(password).hexdigest())
+        else:
+            credential = ("agent",)
+        return (host, port, username, credential)
+
+    def acquire(self, host, username, port=22, privatekey=None,
+                publickey=None, passphrase=None, password=None, timeout=None):
+        """
+        Returns an authenticated session, reusing an idle one when it is
+        still alive. Blocks while max_per_host sessions to host are in use.
+        Authenticates with privatekey when given, else with password, else
+        with the ssh-agent.
+
+        @param timeout: maximum time to wait for a free slot, in seconds
+        @type timeout: float
+
+        @return: authenticated session, to give back with L{release}
+        @rtype: L{Session}
+        """
+        logging.debug("SessionPool.acquire")
+        key = self._key(host, port, username, privatekey, passphrase, password)
+        limit = self._limit(host, port)
+        if not self._wait(limit, timeout):
+            raise SessionPoolException("Too many sessions in use to %s:%s" % (host, port))
+
+        try:
+            pooled = self._pop_idle(key)
+            if pooled is None:
+                pooled = self._connect(key, host, port, username, privatekey,
+                                       publickey, passphrase, password)
+        except:
+            limit.release()
+            raise
+
+        self._lock.acquire()
+        try:
+            self._busy[id(pooled.session)] = pooled
+        finally:
+            self._lock.release()
+        return pooled.session
+
+    def release(self, session, broken=False):
+        """
+        Gives back a session returned by L{acquire}. Broken sessions, or
+        sessions above max_idle_per_key, are closed.
+
+        @param broken: True when the caller saw the session fail
+        @type broken: bool
+        """
+        logging.debug("SessionPool.release")
+        self._lock.acquire()
+        try:
+            pooled = self._busy.pop(id(session))
+            idle = self._idle.setdefault(pooled.key, [])
+            keep = not broken and len(idle) < self.max_idle_per_key
+            if keep:
+                pooled.last_used = time.time()
+                idle.append(pooled)
+        finally:
+            self._lock.release()
+        if not keep:
+            pooled.close()
+        self._limit(pooled.key[0], pooled.key[1]).release()
+
+    @contextmanager
+    def session(self, host, username, **kwargs):
+        """
+        Context manager around L{acquire} and L{release}. The session is
+        dropped if the block raises a libssh2 error.
+        """
+        session = self.acquire(host, username, **kwargs)
+        broken = False
+        try:
+            yield session
+        except _libssh2.Error:
+            broken = True
+            raise
+        finally:
+            self.release(session, broken)
+
+    @contextmanager
+    def channel(self, host, username, **kwargs):
+        """
+        Context manager yielding a new channel on a pooled session.
+        """
+        with self.session(host, username, **kwargs) as session:
+            channel = session.open_session()
+            try:
+                yield channel
+            finally:
+                session.channel_close(channel)
+
+    @contextmanager
+    def sftp(self, host, username, **kwargs):
+        """
+        Context manager yielding the SFTP channel of a pooled session. The
+        SFTP channel stays open with the session for the next user.
+        """
+        with self.session(host, username, **kwargs) as session:
+            pooled = self._busy[id(session)]
+            if pooled.sftp is None:
+                pooled.sftp = session.sftp_init()
+            yield pooled.sftp
+
+    def close(self):
+        """
+        Closes every idle session. Sessions in use are closed when released.
+        """
+        logging.debug("SessionPool.close")
+        self._lock.acquire()
+        try:
+            idle = self._idle
+            self._idle = {}
+            self.max_idle_per_key = 0
+        finally:
+            self._lock.release()
+        for sessions in idle.itervalues():
+            for pooled in sessions:
+                pooled.close()
+
+    def _wait(self, limit, timeout):
+        if timeout is None:
+            return limit.acquire()
+        deadline = time.time() + timeout
+        while not limit.acquire(False):
+            if time.time() >= deadline:
+                return False
+            time.sleep(0.01)
+        return True
+
+    def _pop_idle(self, key):
+        now = time.time()
+        while True:
+            self._lock.acquire()
+            try:
+                idle = self._idle.get(key)
+                if not idle:
+                    return None
+                pooled = idle.pop()
+            finally:
+                self._lock.release()
+            if now - pooled.last_used > self.idle_timeout or not self._alive(pooled, now):
+                pooled.close()
+                continue
+            return pooled
+
+    def _alive(self, pooled, now):
+        # the server closing the connection makes the socket readable
+        # with nothing to read; libssh2 keeps no data between calls
+        try:
+            readable = select.select([pooled.sock], [], [], 0)[0]
+            if readable and not pooled.sock.recv(1, socket.MSG_PEEK):
+                return False
+        except socket.error, e:
+            if e.args[0] not in (errno.EAGAIN, errno.EWOULDBLOCK):
+                return False
+        if self.keepalive_interval and now - pooled.last_used > self.keepalive_interval:
+            try:
+                pooled.session.keepalive_send()
+            except _libssh2.Error, e:
+                logging.debug("SessionPool keepalive failed: %s" % (e,))
+                return False
+        return True
+
+    def _connect(self, key, host, port, username, privatekey, publickey,
+                 passphrase, password):
+        sock = socket.create_connection((host, port), self.connect_timeout)
+        sock.settimeout(None)
+        session = Session()
+        try:
+            session.startup(sock)
+            if privatekey:
+                privatekey = os.path.expanduser(privatekey)
+                if publickey is None:
+                    publickey = privatekey + ".pub"
+                publickey = os.path.expanduser(publickey)
+                session.userauth_publickey_fromfile(username, publickey, privatekey, passphrase)
+            elif password:
+                session.userauth_password(username, password)
+            else:
+                session.userauth_agent(username)
+            if not session.userauth_authenticated():
+                raise SessionPoolException("Authentication failed for %s@%s" % (username, host))
+            # every keepalive_send after this interval really sends a packet
+            session.keepalive_config(True, max(self.keepalive_interval, 1))
+        except:
+            try:
+                session.close()
+            except Exception:
+                pass
+            sock.close()
+            raise
+        return _PooledSession(key, sock, session)
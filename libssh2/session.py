@@ -22,6 +22,7 @@ from sftp import Sftp
 import _libssh2
 import logging
 import os
+import pipes
 import stat
 
 """
@@ -47,6 +48,19 @@ class Session(object):
         """
         logging.debug("Session.__init__")
         self._session = _libssh2.Session()
+        self._sock = None
+
+    def block_directions(self):
+        """
+        Returns the directions the session socket must be ready for before
+        the last call that raised L{WouldBlock} can make progress.
+
+        @return: combination of SESSION_BLOCK_INBOUND and
+        SESSION_BLOCK_OUTBOUND
+        @rtype: int
+        """
+        logging.debug("Session.block_directions")
+        return self._session.block_directions()
 
     def callback_set(self, callback_type, callback):
         """
@@ -82,7 +96,7 @@ class Session(object):
         logging.debug("Session.channel_close")
         self._session.channel_close(channel._channel)
 
-    def direct_tcpip(self, host, port, shost, sport):
+    def direct_tcpip(self, host, port, shost, sport, max_window=0, window_size=0, packet_size=0):
         """
         Tunnels a TCP connection through the session.
 
@@ -94,12 +108,21 @@ class Session(object):
         @type shost: str
         @param sport: local port
         @type sport: int
+        @param max_window: when not 0, the receive window grows with the
+        measured throughput up to max_window bytes
+        @type max_window: int
+        @param window_size: initial receive window, see L{open_session}
+        @type window_size: int
+        @param packet_size: largest data packet the server may send, see
+        L{open_session}
+        @type packet_size: int
 
         @return: new opened L{Channel}
         @rtype: L{Channel}
         """
         logging.debug("Session.direct_tcpip")
-        return Channel(self._session.direct_tcpip(host, port, shost, sport))
+        return Channel(self._session.direct_tcpip(host, port, shost, sport, max_window,
+                                                  window_size, packet_size))
 
     def forward_listen(self, host, port, bound_port, queue_maxsize):
         """
@@ -141,6 +164,28 @@ class Session(object):
         logging.debug("Session.hostkey_hash")
         return self._session.hostkey_hash(hashtype)
 
+    def keepalive_config(self, want_reply, interval):
+        """
+        Configures the keepalive messages sent by L{keepalive_send}.
+
+        @param want_reply: ask the server to answer keepalive messages
+        @type want_reply: bool
+        @param interval: seconds between keepalive messages, 0 disables them
+        @type interval: int
+        """
+        logging.debug("Session.keepalive_config")
+        self._session.keepalive_config(int(want_reply), interval)
+
+    def keepalive_send(self):
+        """
+        Sends a keepalive message if the configured interval has elapsed.
+
+        @return: seconds until the next keepalive message is due
+        @rtype: int
+        """
+        logging.debug("Session.keepalive_send")
+        return self._session.keepalive_send()
+
     def last_error(self):
         """
         Returns the last error in tuple format (code, message).
@@ -151,15 +196,107 @@ class Session(object):
         logging.debug("Session.last_error")
         return self._session.last_error()
 
-    def open_session(self):
+    def open_session(self, max_window=0, window_size=0, packet_size=0):
         """
         Allocates a new L{Channel} for the session.
 
+        With max_window, the receive window is tuned while reading: every
+        round trip it grows to twice the data received in the last one, up
+        to max_window bytes, so that bulk reads over links with a large
+        bandwidth-delay product are not held back by the fixed libssh2
+        window. The current window is in L{Channel.stats}.
+
+        window_size and packet_size replace the libssh2 defaults of 2 MB
+        and 32 KB for the whole life of the channel. A fixed window caps a
+        read at window_size bytes per round trip, tests/test_benchmark_channel.py
+        sweeps both against localhost to pick them for a given link.
+
+        @param max_window: largest receive window in bytes, 0 to keep the
+        fixed libssh2 window
+        @type max_window: int
+        @param window_size: initial receive window in bytes, 0 for the
+        libssh2 default
+        @type window_size: int
+        @param packet_size: largest data packet the server may send, at
+        most 32768, 0 for the libssh2 default
+        @type packet_size: int
+
         @return: new channel opened
         @rtype: L{Channel}
         """
         logging.debug("Session.open_session")
-        return Channel(self._session.open_session())
+        return Channel(self._session.open_session(max_window, window_size, packet_size))
+
+    def poll(self, channels, timeout=-1, events=_libssh2.POLLFD_POLLIN | _libssh2.POLLFD_POLLEXT):
+        """
+        Waits until some of the channels opened on this session are ready.
+
+        @param channels: channels to watch
+        @type channels: list of L{Channel}
+        @param timeout: maximum time to wait in milliseconds, -1 waits for
+        the next session activity
+        @type timeout: int
+        @param events: combination of POLLFD_POLLIN (stdout),
+        POLLFD_POLLEXT (stderr) and POLLFD_POLLOUT (window space)
+        @type events: int
+
+        @return: ready channels with their POLLFD_* events
+        @rtype: list of (L{Channel}, int)
+        """
+        logging.debug("Session.poll")
+        revents = self._session.poll([channel._channel for channel in channels], timeout, events)
+        return [(channel, revent) for channel, revent in zip(channels, revents) if revent]
+
+    def run(self, command, stdin=None, timeout=-1):
+        """
+        Runs command on a new channel and waits for its end, reading stdout
+        and stderr while stdin is written. The whole exchange runs in C
+        without the GIL, much cheaper than driving a L{Channel} by hand.
+
+            status, out, err, signal = session.run("uname -a")
+
+        @param command: command line given to the remote shell
+        @type command: str
+        @param stdin: data written to the command before end of file
+        @type stdin: str
+        @param timeout: maximum duration in milliseconds, -1 uses the
+        session timeout between two socket events. A command timing out has
+        its channel closed, but the remote process is not signalled and may
+        keep running.
+        @type timeout: int
+
+        @return: exit status, stdout, stderr and the name of the signal that
+        killed the command or None
+        @rtype: (int, str, str, str)
+        """
+        logging.debug("Session.run")
+        return self._session.run(command, stdin, timeout)
+
+    def run_many(self, commands, max_channels=8, timeout=-1, callback=None):
+        """
+        Runs commands on up to max_channels channels of the session at once,
+        driven by a single poll loop in C. When the server refuses a channel,
+        the remaining commands wait for the channels already open.
+
+            for status, out, err, signal in session.run_many(["uptime"] * 100):
+                ...
+
+        @param commands: command lines, or (command, stdin) tuples
+        @type commands: sequence
+        @param max_channels: channels open at once
+        @type max_channels: int
+        @param timeout: maximum duration of each command in milliseconds,
+        -1 uses the session timeout between two socket events, see L{run}
+        @type timeout: int
+        @param callback: called with (index, item) as soon as a command ends
+        @type callback: callable
+
+        @return: one item per command, the tuple returned by L{run} or the
+        exception that failed the command
+        @rtype: list
+        """
+        logging.debug("Session.run_many")
+        return self._session.run_many(commands, max_channels, timeout, callback)
 
     def set_trace(self, bitmask):
         """
@@ -170,18 +307,25 @@ class Session(object):
         logging.debug("Session.scp_recv")
         self._session.set_trace(bitmask)
 
-    def scp_recv(self, remote_path):
+    def scp_recv(self, remote_path, max_window=0, window_size=0):
         """
         Gets a remote file via SCP Protocol.
 
         @param remote_path: absolute path of remote file to transfer
         @type remote_path: str
+        @param max_window: largest receive window in bytes, 0 to keep the
+        fixed libssh2 window, see L{open_session}
+        @type max_window: int
+        @param window_size: receive window granted once the channel is
+        open, 0 for the libssh2 default. libssh2 opens SCP channels with
+        its default window and packet size, the window can only grow.
+        @type window_size: int
 
         @return: new channel opened, mode, size
         @rtype: L{Channel}, mode, size
         """
         logging.debug("Session.scp_recv")
-        _channel, fileInfo = self._session.scp_recv(remote_path)
+        _channel, fileInfo = self._session.scp_recv(remote_path, max_window, window_size)
         return (Channel(_channel), fileInfo)
 
     def scp_send(self, path, mode, size, mtime=0, atime=0):
@@ -205,67 +349,75 @@ class Session(object):
         logging.debug("Session.scp_send")
         return Channel(self._session.scp_send(path, int(mode), size, int(mtime), int(atime)))
 
+    def scp_send_fd(self, fd, remote_path, mode, size, mtime=0, atime=0, chunk=128 * 1024):
+        """
+        Sends size bytes of the file descriptor fd to remote_path via SCP
+        protocol, without going back to python for each chunk.
+
+        @param fd: seekable local file descriptor
+        @type fd: int
+        @param remote_path: absolute path of the remote file
+        @type remote_path: str
+        @param mode: file access mode to create file
+        @type mode: int
+        @param size: number of bytes to transfer
+        @type size: long
+        @param chunk: size of each read and channel write
+        @type chunk: int
+
+        @return: number of bytes sent
+        @rtype: long
+        """
+        logging.debug("Session.scp_send_fd")
+        return self._session.scp_send_fd(fd, remote_path, int(mode), size, int(mtime), int(atime), chunk)
+
     def scp_send_file(self, in_file_path, out_file_path):
-        write_len = 4096
-        file_stat = os.stat(in_file_path)
-        f = open(in_file_path, "rb")
-        channel = self.scp_send(out_file_path, stat.S_IMODE(file_stat.st_mode), file_stat.st_size, int(file_stat.st_mtime), int(file_stat.st_atime))
-        if not channel:
-            print "Failed to open channel"
-            return
-        buf = f.read(write_len)
-        while True:
-            if len(buf) > 0:
-                written = channel.write(buf)
-                if written == 0:
-                    continue
-                elif written == write_len:
-                    buf = f.read(write_len)
-                else:
-                    buf = buf[written:-1]
-            else:
-                break
-        channel.flush()
-        channel.send_eof()
-        channel.wait_eof()
+        fd = os.open(in_file_path, os.O_RDONLY)
         try:
-            channel.wait_closed()
-            self.channel_close(channel)
-        except Exception, detail:
-            print "Failed to close %s" % (detail)
-
-    def scp_recv_file(self, in_file_path, out_file_path):
-        read_len = 1024
-        channel, fileInfo = self.scp_recv(in_file_path)
-        if not channel:
-            print "Failed to open channel"
-            return
-
-        f = open(out_file_path, "wb")
-        file_size = fileInfo['st_size']
-        got = 0
-        buf = None
-        while got < file_size:
-            try:
-                buf = channel.read(min(read_len, file_size - got))
-                l = len(buf)
-                if l > 0:
-                    f.write(buf)
-                    got += l
-                buf = None
-            except Exception, detail:
-                f.close()
-                self.channel_close(channel)
-                raise
+            file_stat = os.fstat(fd)
+            self.scp_send_fd(fd, out_file_path, stat.S_IMODE(file_stat.st_mode), file_stat.st_size, int(file_stat.st_mtime), int(file_stat.st_atime))
+        finally:
+            os.close(fd)
 
+    def scp_recv_fd(self, remote_path, fd, chunk=128 * 1024, preallocate=True, max_window=0,
+                    window_size=0):
+        """
+        Requests remote_path via SCP protocol and writes it to the file
+        descriptor fd, without going back to python for each chunk.
+
+        @param remote_path: absolute path of the remote file
+        @type remote_path: str
+        @param fd: seekable local file descriptor
+        @type fd: int
+        @param chunk: size of each channel read
+        @type chunk: int
+        @param preallocate: reserve the file size before writing, if the
+        transfer fails the file loses the reserved tail past its old size
+        @type preallocate: bool
+        @param max_window: largest receive window in bytes, 0 to keep the
+        fixed libssh2 window, see L{open_session}
+        @type max_window: int
+        @param window_size: receive window granted once the channel is
+        open, see L{scp_recv}
+        @type window_size: int
+
+        @return: stat of the remote file
+        @rtype: SftpAttributes
+        """
+        logging.debug("Session.scp_recv_fd")
+        return self._session.scp_recv_fd(remote_path, fd, chunk, int(preallocate), max_window,
+                                         window_size)
+
+    def scp_recv_file(self, in_file_path, out_file_path, max_window=0, window_size=0):
+        fd = os.open(out_file_path, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0644)
         try:
-            self.channel_close(channel)
-        except Exception, detail:
-            print "Failed to close %s" % (detail)
+            fileInfo = self.scp_recv_fd(in_file_path, fd, max_window=max_window,
+                                        window_size=window_size)
+        finally:
+            os.close(fd)
 
-        f.close()
         os.chmod(out_file_path, fileInfo['st_mode'])
-        os.utime(out_file_path, (fileInfo['st_mtime'], fileInfo['st_atime']))
+        os.utime(out_file_path, (fileInfo['st_atime'], fileInfo['st_mtime']))
 
     def session_method_pref(self, method_type, pref):
         """
@@ -316,7 +468,7 @@ class Session(object):
         @rtype: L{Sftp}
         """
         logging.debug("Session.sftp_init")
-        return Sftp(self._session.sftp_init())
+        return Sftp(self._session.sftp_init(), self)
 
     def sftp_shutdown(self, sftp):
         """
@@ -336,6 +488,45 @@ class Session(object):
         """
         logging.debug("Session.startup")
         self._session.startup(sock)
+        self._sock = sock
+
+    def fileno(self):
+        """
+        Returns the file descriptor of the socket given to L{startup}, so a
+        session can be passed to select() or poll().
+
+        @rtype: int
+        """
+        return self._sock.fileno()
+
+    def set_blocking(self, block=True):
+        """
+        Sets the blocking mode of the session. In non-blocking mode, calls
+        that would block raise L{WouldBlock}.
+
+        @param block: True for blocking, False for non-blocking
+        @type block: bool
+        """
+        logging.debug("Session.set_blocking")
+        self._session.set_blocking(int(block))
+
+    def stats(self):
+        """
+        Returns a snapshot of the counters of the libssh2 calls made by the
+        session, with a breakdown per open object. Each counter set holds
+        calls, bytes_read, bytes_written, eagain, errors and blocked_ns, the
+        time spent inside libssh2 in nanoseconds.
+
+            totals = session.stats()["session"]
+            print totals["bytes_read"], totals["blocked_ns"] / 1e9
+
+        @return: 'session': totals of the session, and 'channels', 'sftps',
+        'files', 'directories': lists of (native object, counters) for the
+        objects still open
+        @rtype: dict
+        """
+        logging.debug("Session.stats")
+        return self._session.stats()
 
     def userauth_authenticated(self):
         """
@@ -440,24 +631,27 @@ class Session(object):
         except:
             raise
 
-    def mv(self, src, dst):
-        if hasattr(src, "__iter__") or hasattr(src, "next"):
-            while len(src) > 0:
-                channel = self.open_session()
-                length = min(100, len(src))
-                batch = src[:length]
-                channel.execute("mv %s %s" % (" ".join(batch), dst))
-                src = src[length:]
-                try:
-                    #channel.read(-1)
-                    self.channel_close(channel)
-                except:
-                    pass
-        else:
-            channel.execute("mv %s %s" % (src, dst))
-            try:
-                #channel.read(-1)
-                self.channel_close(channel)
-            except:
-                pass
-
+    def mv(self, src, dst, max_channels=8):
+        """
+        Moves the remote path src, or each path of the list src, to dst
+        with one mv command per path, max_channels of them at a time.
+
+        @return: the results of L{run_many}
+        @rtype: list
+        @raise SessionException: when any of the moves failed, once all of
+        them have run
+        """
+        logging.debug("Session.mv")
+        if isinstance(src, basestring):
+            src = [src]
+        results = self.run_many(["mv -- %s %s" % (pipes.quote(path), pipes.quote(dst))
+                                 for path in src], max_channels)
+        failures = []
+        for path, result in zip(src, results):
+            if isinstance(result, Exception):
+                failures.append("%s: %s" % (path, result))
+            elif result[0] != 0 or result[3] is not None:
+                failures.append("%s: %s" % (path, result[2].strip() or "exit status %s" % (result[0],)))
+        if failures:
+            raise SessionException("mv to %s failed for %s" % (dst, "; ".join(failures)))
+        return results
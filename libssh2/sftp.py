@@ -18,16 +18,27 @@
 # 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #
 
+from collections import deque
 from sftpdir import SftpDir
 from sftpfile import SftpFile
+from transfer import DOWNLOAD, UPLOAD, TransferManager, TransferReport, TransferResult
 import errno
+import hashlib
 import logging
+import os
+import pipes
+import posixpath
+import stat
 import sys
+import time
 
 """
 Abstraction for libssh2 L{Sftp} object
 """
 
+# printed by the server side copy of Sftp.copy_file once cp succeeded
+COPY_MARKER = "pylibssh2-copy-done"
+
 
 class SftpException(Exception):
     """
@@ -40,11 +51,12 @@ class Sftp(object):
     """
     Sftp object
     """
-    def __init__(self, _sftp):
+    def __init__(self, _sftp, session=None):
         """
         Create a new Sftp object.
         """
         self._sftp = _sftp
+        self._session = session
 
     def open_dir(self, path):
         """
@@ -128,12 +140,43 @@ class Sftp(object):
         logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
         self.rename(src, dst)
 
-    def copy_file(self, src, dst):
+    def copy_file(self, src, dst, pipeline_depth=16):
+        """
+        Copies the remote file src to dst. The copy is first made on the
+        server with cp over an exec channel, which moves no data over the
+        network. When that fails the data goes through this client with
+        L{SftpFile.copy_to}, without ever reaching Python.
+
+        libssh2 can not send SFTP extension requests, so copy-data is not
+        used. dst is always the file to write, cp -T keeps it from copying
+        into a directory, a cp without -T falls back on the SFTP copy. The
+        server copy counts only when cp reports success on stdout, an exec
+        channel that runs something else falls back on the SFTP copy too.
+
+        @param pipeline_depth: requests in flight for the client side copy
+        @type pipeline_depth: int
+        """
+        logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        if self._session is not None:
+            try:
+                # an exec channel forced to sftp-server exits 0 without
+                # running cp, only the marker proves the copy was made
+                status, output = self._remote_command("cp -T -- %s %s && echo %s" %
+                                                      (pipes.quote(src), pipes.quote(dst), COPY_MARKER))
+                if status == 0 and output.strip() == COPY_MARKER:
+                    return
+            except Exception, e:
+                logging.debug("Sftp remote copy failed: %s" % (e,))
+
         src_file = self.open_file(src, "r")
-        dst_file = self.open_file(dst, "w")
-        dst_file.write(src_file.read(-1))
-        self.close_file(src_file)
-        self.close_file(dst_file)
+        try:
+            dst_file = self.open_file(dst, "w")
+            try:
+                src_file.copy_to(dst_file, 30000, pipeline_depth)
+            finally:
+                self.close_file(dst_file)
+        finally:
+            self.close_file(src_file)
 
     def mkdir(self, path, mode=0755):
         """
@@ -184,12 +227,100 @@ class Sftp(object):
         logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
         self._sftp.set_stat(path, attrs)
 
-    def get(self, src, dst):
+    def list_dirs(self, paths, helpers=None):
         """
-        Helper function that acts like the CLI get command
+        Lists several directories at once, one per SFTP channel among this
+        one and helpers, which must be Sftp objects of the same session.
+
+        @return: one item per path, a list of (name, SftpAttributes) or the
+        exception that failed the listing
+        @rtype: list
+        """
+        logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        if helpers:
+            helpers = [helper._sftp for helper in helpers]
+        return self._sftp.list_dirs(paths, helpers)
+
+    def stats(self):
+        """
+        Returns the counters of the metadata calls (open, stat, rename...)
+        made on this SFTP channel. Reads and writes are counted on the
+        L{SftpFile} and L{SftpDir} objects.
+
+        @return: calls, bytes_read, bytes_written, eagain, errors and
+        blocked_ns, the time spent inside libssh2 in nanoseconds, and id,
+        the id of the object in the traces
+        @rtype: dict
+        """
+        logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        return self._sftp.stats()
+
+    def walk(self, top, concurrency=8, onerror=None):
         """
+        Walks the remote tree under top like os.walk, top down, listing up
+        to concurrency directories at once over extra SFTP channels of the
+        same session. Removing names from dirs prunes the walk. Symbolic
+        links are not followed.
 
+            for dirpath, dirs, files in sftp.walk("/var/spool"):
+                for name, attrs in files:
+                    print dirpath, name, attrs.st_size
+
+        @param top: remote directory to start from
+        @type top: str
+        @param concurrency: number of directories listed at once
+        @type concurrency: int
+        @param onerror: called with the exception of a directory that can
+        not be listed, which is then skipped
+        @type onerror: callable
+
+        @return: generator of (dirpath, dirs, files) where files is a list
+        of (name, SftpAttributes)
+        @rtype: generator
+        """
         logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        helpers = []
+        try:
+            if self._session is not None:
+                for i in range(concurrency - 1):
+                    helpers.append(self._session.sftp_init())
+            pending = deque([top])
+            while pending:
+                # twice the channels keeps them busy across the batch
+                paths = [pending.popleft() for i in range(min(len(pending), 2 * concurrency))]
+                for path, listing in zip(paths, self.list_dirs(paths, helpers)):
+                    if isinstance(listing, Exception):
+                        if onerror is not None:
+                            onerror(listing)
+                        continue
+                    dirs = []
+                    files = []
+                    for name, attrs in listing:
+                        if name in (".", ".."):
+                            continue
+                        if stat.S_ISDIR(attrs.st_mode):
+                            dirs.append(name)
+                        else:
+                            files.append((name, attrs))
+                    yield path, dirs, files
+                    for name in dirs:
+                        pending.append(posixpath.join(path, name))
+        finally:
+            for helper in helpers:
+                self._session.sftp_shutdown(helper)
+
+    def get(self, src, dst, pipeline_depth=None, chunk_size=30000):
+        """
+        Helper function that acts like the CLI get command
+
+        @param pipeline_depth: chunk_size * pipeline_depth bytes are asked
+        at a time, see L{SftpFile.read_pipelined}, None issues one request
+        per chunk
+        @type pipeline_depth: int
+        @param chunk_size: size of each READ request when pipelining, at
+        most 30000
+        @type chunk_size: int
+        """
         BUFFER_SIZE = 4096
 
         logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
@@ -197,21 +328,51 @@ class Sftp(object):
         src_file = self.open_file(src, "r")
         dst_file = open(dst, "w", 0644)
         # Send loop
-        read_buffer = src_file.read(BUFFER_SIZE)
-        while read_buffer:
-            dst_file.write(read_buffer)
+        if pipeline_depth:
+            read_size = max(chunk_size * pipeline_depth, 1024 * 1024)
+            read_buffer = src_file.read_pipelined(read_size, chunk_size, pipeline_depth)
+            while read_buffer:
+                dst_file.write(read_buffer)
+                read_buffer = src_file.read_pipelined(read_size, chunk_size, pipeline_depth)
+        else:
             read_buffer = src_file.read(BUFFER_SIZE)
+            while read_buffer:
+                dst_file.write(read_buffer)
+                read_buffer = src_file.read(BUFFER_SIZE)
         # Close Files
         dst_file.close()
         self.close_file(src_file)
 
-    def put(self, src, dst):
+    def put(self, src, dst, pipeline_depth=None, chunk_size=30000):
         """
         Helper function that acts like the CLI put command
+
+        @param src: local path, or file descriptor when pipelining
+        @type src: str or int
+        @param pipeline_depth: number of WRITE requests kept in flight, None
+        issues one request per chunk
+        @type pipeline_depth: int
+        @param chunk_size: size of each WRITE request when pipelining
+        @type chunk_size: int
+
+        @return: number of bytes acknowledged when pipelining
+        @rtype: long
         """
         BUFFER_SIZE = 4096
 
         logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        if pipeline_depth:
+            dst_file = self.open_file(dst, "w", 0644)
+            if isinstance(src, (int, long)):
+                acked = dst_file.write_pipelined(src, chunk_size, pipeline_depth)
+            else:
+                src_fd = os.open(src, os.O_RDONLY)
+                try:
+                    acked = dst_file.write_pipelined(src_fd, chunk_size, pipeline_depth)
+                finally:
+                    os.close(src_fd)
+            self.close_file(dst_file)
+            return acked
         # Open Files
         src_file = open(src, "r")
         dst_file = self.open_file(dst, "w", 0644)
@@ -223,3 +384,304 @@ class Sftp(object):
         # Close Files
         self.close_file(dst_file)
         src_file.close()
+
+    def put_delta(self, src, dst, block_size=1024 * 1024, pipeline_depth=16):
+        """
+        Uploads src over an existing dst by rewriting only the blocks of
+        block_size bytes whose SHA-1 differ, then truncating dst to the size
+        of src. The remote hashes come from sha1sum run on the server when
+        the session allows it, else from reading dst over SFTP, which still
+        sends only the changed blocks. A missing dst is sent with L{put}.
+
+        @param src: local path
+        @type src: str
+        @param dst: remote path
+        @type dst: str
+        @param block_size: size of the compared blocks
+        @type block_size: int
+        @param pipeline_depth: requests in flight to read dst or upload
+        the whole file
+        @type pipeline_depth: int
+
+        @return: dict with the number of "blocks", of "changed" blocks, the
+        "bytes" written and the "hashes" source, "exec" or "sftp"
+        @rtype: dict
+        """
+        logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        size = os.stat(src).st_size
+        blocks = (size + block_size - 1) / block_size
+        try:
+            remote_size = self.get_stat(dst).st_size
+        except IOError, e:
+            if e.errno != errno.ENOENT:
+                raise
+            sent = self.put(src, dst, pipeline_depth)
+            return {"blocks": blocks, "changed": blocks, "bytes": sent, "hashes": None}
+
+        hashes, origin = self._remote_block_hashes(dst, remote_size, block_size, pipeline_depth)
+        changed = 0
+        sent = 0
+        src_file = open(src, "rb")
+        dst_file = self.open_file(dst, "r+")
+        try:
+            for index in xrange(blocks):
+                data = src_file.read(block_size)
+                if index < len(hashes) and hashlib.sha1(data).hexdigest() == hashes[index]:
+                    continue
+                changed += 1
+                dst_file.seek(index * block_size)
+                written = 0
+                while written < len(data):
+                    written += dst_file.write(buffer(data, written))
+                sent += written
+            if remote_size > size:
+                dst_file.truncate(size)
+        finally:
+            self.close_file(dst_file)
+            src_file.close()
+        return {"blocks": blocks, "changed": changed, "bytes": sent, "hashes": origin}
+
+    def _remote_block_hashes(self, path, size, block_size, pipeline_depth):
+        count = (size + block_size - 1) / block_size
+        if self._session is not None and count:
+            # one dd per block keeps to POSIX sh and coreutils
+            command = ("f=%s; i=0; while [ $i -lt %d ]; do "
+                       "dd if=\"$f\" bs=%d skip=$i count=1 2>/dev/null | sha1sum || exit 1; "
+                       "i=$((i+1)); done" % (pipes.quote(path), count, block_size))
+            try:
+                status, output = self._remote_command(command)
+                hashes = [line.split()[0] for line in output.splitlines() if line]
+                if status == 0 and len(hashes) == count:
+                    return hashes, "exec"
+            except Exception, e:
+                logging.debug("Sftp remote hash failed: %s" % (e,))
+
+        hashes = []
+        remote_file = self.open_file(path, "r")
+        try:
+            for index in xrange(count):
+                digest = hashlib.sha1()
+                remaining = block_size
+                while remaining > 0:
+                    data = remote_file.read_pipelined(remaining, 30000, pipeline_depth)
+                    if not data:
+                        break
+                    digest.update(data)
+                    remaining -= len(data)
+                hashes.append(digest.hexdigest())
+        finally:
+            self.close_file(remote_file)
+        return hashes, "sftp"
+
+    def hash(self, path, algo="sha256", offset=0, length=None):
+        """
+        Hashes length bytes of the remote file path from offset, by default
+        the whole file, on the server. See L{hash_many}.
+
+        @return: hexadecimal digest
+        @rtype: str
+        """
+        logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        return self.hash_many([path], algo, offset, length)[path]
+
+    def hash_many(self, paths, algo="sha256", offset=0, length=None, max_channels=8):
+        """
+        Hashes remote files on the server, so that checking a transfer
+        does not read the data back. Up to max_channels commands such as
+        sha256sum run at once, each on its own exec channel of the session.
+        Files whose command fails are read over SFTP and hashed locally.
+
+        libssh2 can not send SFTP extension requests, so the check-file
+        extension is not used.
+
+        @param paths: remote paths
+        @type paths: list of str
+        @param algo: md5, sha1, sha224, sha256, sha384 or sha512
+        @type algo: str
+        @param offset: first byte hashed
+        @type offset: long
+        @param length: number of bytes hashed, None up to the end
+        @type length: long
+        @param max_channels: commands run at once
+        @type max_channels: int
+
+        @return: path -> hexadecimal digest
+        @rtype: dict
+        """
+        logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        if algo not in ("md5", "sha1", "sha224", "sha256", "sha384", "sha512"):
+            raise ValueError("unsupported hash algorithm %s" % (algo,))
+
+        digests = {}
+        if self._session is not None:
+            commands = []
+            for path in paths:
+                # the file is stdin so the digest is the first word
+                pipeline = []
+                if offset:
+                    pipeline.append("tail -c +%d 2>/dev/null" % (offset + 1,))
+                if length is not None:
+                    pipeline.append("head -c %d" % (length,))
+                pipeline.append("%ssum" % (algo,))
+                commands.append("(%s) < %s" % (" | ".join(pipeline), pipes.quote(path)))
+            try:
+                results = self._session.run_many(commands, max_channels)
+            except Exception, e:
+                logging.debug("Sftp remote hash failed: %s" % (e,))
+                results = []
+            for path, result in zip(paths, results):
+                if isinstance(result, Exception):
+                    logging.debug("Sftp remote hash failed: %s" % (result,))
+                elif result[0] == 0 and result[1].split():
+                    digests[path] = result[1].split()[0]
+
+        for path in paths:
+            if path not in digests:
+                digests[path] = self._local_hash(path, algo, offset, length)
+        return digests
+
+    def _local_hash(self, path, algo, offset, length):
+        digest = hashlib.new(algo)
+        remote_file = self.open_file(path, "r")
+        try:
+            remote_file.seek(offset)
+            while length is None or length > 0:
+                size = 1024 * 1024
+                if length is not None:
+                    size = min(size, length)
+                data = remote_file.read_pipelined(size, 30000, 16)
+                if not data:
+                    break
+                digest.update(data)
+                if length is not None:
+                    length -= len(data)
+        finally:
+            self.close_file(remote_file)
+        return digest.hexdigest()
+
+    def _remote_command(self, command):
+        # runs command on the session of this channel: (exit status, stdout)
+        status, output, error, signal = self._session.run(command)
+        return status, output
+
+    def sync(self, local_dir, remote_dir, direction=UPLOAD, sessions=None, pipeline_depth=16):
+        """
+        Mirrors local_dir to remote_dir (UPLOAD) or remote_dir to local_dir
+        (DOWNLOAD). Regular files whose size or mtime, in whole seconds,
+        differ from the destination are transferred, then get the access
+        and modification times of their source. Missing directories are
+        created; nothing is deleted. An unchanged tree costs only the
+        directory listings.
+
+        @param direction: UPLOAD or DOWNLOAD
+        @type direction: str
+        @param sessions: authenticated sessions to the same host used to
+        transfer several files at once, by default the transfers go one
+        after the other over this channel
+        @type sessions: list of L{Session}
+        @param pipeline_depth: requests in flight per transfer
+        @type pipeline_depth: int
+
+        @return: the transferred files
+        @rtype: L{TransferReport}
+        """
+        logging.debug("Sftp." + sys._getframe(0).f_code.co_name)
+        if direction not in (DOWNLOAD, UPLOAD):
+            raise ValueError("direction must be DOWNLOAD or UPLOAD")
+        if direction == UPLOAD and not self.exists(remote_dir):
+            self.mkdir(remote_dir)
+        elif direction == DOWNLOAD and not os.path.isdir(local_dir):
+            os.makedirs(local_dir)
+
+        local_files, local_dirs = self._sync_local_tree(local_dir)
+        remote_files, remote_dirs = self._sync_remote_tree(remote_dir)
+        if direction == UPLOAD:
+            sources, targets = local_files, remote_files
+            missing_dirs = sorted(local_dirs - remote_dirs)
+        else:
+            sources, targets = remote_files, local_files
+            missing_dirs = sorted(remote_dirs - local_dirs)
+
+        for relpath in missing_dirs:
+            if direction == UPLOAD:
+                self.mkdir(posixpath.join(remote_dir, relpath))
+            else:
+                os.mkdir(os.path.join(local_dir, relpath))
+
+        transfers = []
+        # remote path -> (size, atime, mtime) of the source
+        times = {}
+        for relpath, (size, atime, mtime) in sources.iteritems():
+            target = targets.get(relpath)
+            if target is not None and target[0] == size and target[2] == mtime:
+                continue
+            local_path = os.path.join(local_dir, *relpath.split("/"))
+            remote_path = posixpath.join(remote_dir, relpath)
+            times[remote_path] = (size, atime, mtime)
+            if direction == UPLOAD:
+                transfers.append((local_path, remote_path, size))
+            else:
+                transfers.append((remote_path, local_path, size))
+
+        if sessions:
+            manager = TransferManager(sessions, direction, "sftp", pipeline_depth)
+            report = manager.run(transfers)
+        else:
+            results = []
+            start = time.time()
+            for src, dst, size in transfers:
+                result = TransferResult(src, dst, size)
+                result.start = time.time()
+                try:
+                    if direction == UPLOAD:
+                        self.put(src, dst, pipeline_depth)
+                    else:
+                        self.get(src, dst, pipeline_depth)
+                except Exception:
+                    result.error = sys.exc_info()[1]
+                    logging.debug("Sftp.sync %s failed: %s" % (src, result.error))
+                result.end = time.time()
+                results.append(result)
+            report = TransferReport(results, time.time() - start)
+
+        for result in report.results:
+            if result.error is not None:
+                continue
+            if direction == UPLOAD:
+                size, atime, mtime = times[result.dst]
+                self.set_stat(result.dst, {"st_atime": atime, "st_mtime": mtime})
+            else:
+                size, atime, mtime = times[result.src]
+                os.utime(result.dst, (atime, mtime))
+        return report
+
+    def _sync_local_tree(self, top):
+        # relpath with "/" separators -> (size, atime, mtime), set of dirs
+        files = {}
+        dirs = set()
+        for dirpath, dirnames, filenames in os.walk(top):
+            reldir = os.path.relpath(dirpath, top).replace(os.sep, "/")
+            for name in dirnames:
+                dirs.add(posixpath.normpath(posixpath.join(reldir, name)))
+            for name in filenames:
+                st = os.lstat(os.path.join(dirpath, name))
+                if stat.S_ISREG(st.st_mode):
+                    relpath = posixpath.normpath(posixpath.join(reldir, name))
+                    files[relpath] = (st.st_size, int(st.st_atime), int(st.st_mtime))
+        return files, dirs
+
+    def _sync_remote_tree(self, top):
+        def fail(error):
+            raise error
+
+        files = {}
+        dirs = set()
+        for dirpath, dirnames, filenames in self.walk(top, onerror=fail):
+            reldir = posixpath.relpath(dirpath, top)
+            for name in dirnames:
+                dirs.add(posixpath.normpath(posixpath.join(reldir, name)))
+            for name, attrs in filenames:
+                if stat.S_ISREG(attrs.st_mode):
+                    relpath = posixpath.normpath(posixpath.join(reldir, name))
+                    files[relpath] = (attrs.st_size, attrs.st_atime, attrs.st_mtime)
+        return files, dirs
@@ -52,3 +52,44 @@ class SftpDir(object):
         """
         logging.debug("Sftpdir." + sys._getframe(0).f_code.co_name)
         return self._handle.list_files()
+
+    def read_batch(self, batch=256):
+        """
+        Reads up to batch entries at once.
+
+        @return: list of (name, SftpAttributes), empty at the end of the directory
+        @rtype: list
+        """
+        logging.debug("Sftpdir." + sys._getframe(0).f_code.co_name)
+        return self._handle.read_batch(batch)
+
+    def stats(self):
+        """
+        Returns the counters of the libssh2 calls made on this directory.
+
+        @return: calls, bytes_read, bytes_written, eagain, errors and
+        blocked_ns, the time spent inside libssh2 in nanoseconds, and id,
+        the id of the object in the traces
+        @rtype: dict
+        """
+        logging.debug("Sftpdir." + sys._getframe(0).f_code.co_name)
+        return self._handle.stats()
+
+    def iter_entries(self, batch=256):
+        """
+        Yields the directory entries batch by batch, so that listing a huge
+        directory keeps at most batch entries in memory.
+
+            for entries in sftp_dir.iter_entries(1024):
+                for name, stat in entries:
+                    ...
+
+        @return: generator of lists of (name, SftpAttributes)
+        @rtype: generator
+        """
+        logging.debug("Sftpdir." + sys._getframe(0).f_code.co_name)
+        while True:
+            entries = self._handle.read_batch(batch)
+            if not entries:
+                break
+            yield entries
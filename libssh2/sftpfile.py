@@ -61,12 +61,81 @@ class SftpFile(object):
         else:
             return self._handle.read(maxlen)
 
+    def readinto(self, buffer):
+        """
+        Reads directly into buffer without any intermediate copy.
+
+        @param buffer: writable buffer (bytearray, memoryview, mmap...)
+        @type buffer: buffer
+
+        @return: number of bytes read, 0 on end of file
+        @rtype: int
+        """
+        logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
+        return self._handle.readinto(buffer)
+
+    def read_pipelined(self, total, chunk=30000, depth=16):
+        """
+        Reads up to total bytes asking libssh2 for chunk * depth bytes at
+        a time. libssh2 sends READ requests of at most 30000 bytes and
+        reads ahead up to four times the length asked, at most 8 MB, so
+        the defaults keep about 64 requests in flight.
+
+        @param total: maximum number of bytes to read
+        @type total: int
+        @param chunk: bytes per READ request, libssh2 caps it at 30000
+        @type chunk: int
+        @param depth: chunk * depth is the length asked at a time
+        @type depth: int
+
+        @return: bytes read, shorter than total at end of file or when a
+        read fails after some data arrived, the next call then raises
+        @rtype: str
+        """
+        logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
+        return self._handle.read_pipelined(total, chunk, depth)
+
     def write(self, message):
         """
+        Writes message, which can be any readable buffer (str, memoryview
+        slice, mmap...).
         """
         logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
         return self._handle.write(message)
 
+    def write_pipelined(self, fd, chunk=30000, depth=16):
+        """
+        Uploads fd from its current position keeping depth WRITE requests
+        in flight, falling back to sequential writes if the server rejects
+        them.
+
+        @param fd: seekable local file descriptor
+        @type fd: int
+        @param chunk: size of each WRITE request
+        @type chunk: int
+        @param depth: number of WRITE requests kept outstanding
+        @type depth: int
+
+        @return: number of bytes acknowledged by the server
+        @rtype: long
+        """
+        logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
+        return self._handle.write_pipelined(fd, chunk, depth)
+
+    def copy_to(self, dst, chunk=30000, depth=16):
+        """
+        Copies this file from its current position to its end into dst,
+        with the read and write loop running natively.
+
+        @param dst: remote file opened for writing
+        @type dst: L{SftpFile}
+
+        @return: number of bytes copied
+        @rtype: long
+        """
+        logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
+        return self._handle.copy_to(dst._handle, chunk, depth)
+
     def tell(self):
         """
         """
@@ -78,3 +147,25 @@ class SftpFile(object):
         """
         logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
         self._handle.seek(offset)
+
+    def truncate(self, size):
+        """
+        Sets the size of the remote file.
+
+        @param size: new size of the file
+        @type size: long
+        """
+        logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
+        self._handle.truncate(size)
+
+    def stats(self):
+        """
+        Returns the counters of the libssh2 calls made on this file.
+
+        @return: calls, bytes_read, bytes_written, eagain, errors and
+        blocked_ns, the time spent inside libssh2 in nanoseconds, and id,
+        the id of the object in the traces
+        @rtype: dict
+        """
+        logging.debug("Sftpfile." + sys._getframe(0).f_code.co_name)
+        return self._handle.stats()
@@ -0,0 +1,219 @@
+#
+# pylibssh2 - python bindings for libssh2 library
+#
+# Copyright (C) 2010 Wallix Inc.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by the
+# Free Software Foundation; either version 2.1 of the License, or (at your
+# option) any later version.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+# details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+#
+import _libssh2
+import logging
+import time
+"""
+Spans of the SFTP, SCP, channel and session calls
+
+The native module records one event per call in a ring buffer and hands
+them over in batches, so that tracing does not call into Python for every
+read or write. L{Tracer} turns the batches into L{Span} objects, named and
+timed like OpenTelemetry spans, and passes them to its exporters.
+
+    tracer = Tracer([lambda spans: log.extend(spans)])
+    tracer.start()
+    sftp.get("/remote/file", "file")
+    tracer.stop()
+    slowest = max(log, key=lambda span: span.duration)
+"""
+
+# libssh2 return code of a call that would block
+ERROR_EAGAIN = -37
+
+# values of the OTLP Status.code enum, instrumentation leaves a call that
+# succeeded unset and only marks errors
+STATUS_CODE_UNSET = 0
+STATUS_CODE_OK = 1
+STATUS_CODE_ERROR = 2
+
+
+def clock_offset():
+    """
+    Returns what to add to the native event times to get nanoseconds since
+    the epoch.
+
+    @rtype: long
+    """
+    return long(time.time() * 1e9) - _libssh2.trace_clock()
+
+
+def any_value(value):
+    """
+    Returns value as an OTLP JSON AnyValue.
+
+    @type value: int, long or str
+    @rtype: dict
+    """
+    if isinstance(value, (int, long)):
+        return {"intValue": str(value)}
+    return {"stringValue": value}
+
+
+class Span(object):
+    """
+    One finished libssh2 call.
+    """
+    def __init__(self, event, offset=0):
+        """
+        @param event: event returned by _libssh2.trace_drain or given to the
+        trace callback
+        @type event: tuple
+        @param offset: result of L{clock_offset}
+        @type offset: long
+        """
+        (self.operation, self.object_id, self.session_id, self.path,
+         start_ns, end_ns, self.rc, self.bytes_read, self.bytes_written) = event
+        self.start_time_unix_nano = start_ns + offset
+        self.end_time_unix_nano = end_ns + offset
+
+    @property
+    def name(self):
+        return "libssh2." + self.operation
+
+    @property
+    def duration(self):
+        """
+        Duration of the call, in seconds.
+        """
+        return (self.end_time_unix_nano - self.start_time_unix_nano) / 1e9
+
+    @property
+    def error(self):
+        """
+        True when the call failed, a call that would block is not a failure.
+        """
+        return self.rc < 0 and self.rc != ERROR_EAGAIN
+
+    def attributes(self):
+        """
+        @return: span attributes, following the OpenTelemetry naming rules
+        @rtype: dict
+        """
+        attributes = {
+            "libssh2.object_id": self.object_id,
+            "libssh2.session_id": self.session_id,
+            "libssh2.rc": self.rc,
+            "libssh2.bytes_read": self.bytes_read,
+            "libssh2.bytes_written": self.bytes_written,
+        }
+        if self.path is not None:
+            attributes["libssh2.path"] = self.path
+        return attributes
+
+    def to_dict(self):
+        """
+        @return: the span in the layout of the OTLP JSON encoding: typed
+        AnyValue attributes, 64 bits integers as strings, enums as integers.
+        The trace and span ids are left to the caller.
+        @rtype: dict
+        """
+        return {
+            "name": self.name,
+            "startTimeUnixNano": str(self.start_time_unix_nano),
+            "endTimeUnixNano": str(self.end_time_unix_nano),
+            "attributes": [{"key": key, "value": any_value(value)}
+                           for key, value in sorted(self.attributes().items())],
+            "status": {"code": self.error and STATUS_CODE_ERROR or STATUS_CODE_UNSET},
+        }
+
+    def __repr__(self):
+        return "<Span %s %s %.6fsec rc=%d>" % (self.name, self.path, self.duration, self.rc)
+
+
+class OpenTelemetryExporter(object):
+    """
+    Replays the spans on an OpenTelemetry tracer, any object with a
+    start_span(name, start_time=..., attributes=...) method returning spans
+    with set_status and end(end_time=...).
+    """
+    def __init__(self, tracer, error_status=None):
+        """
+        @param tracer: OpenTelemetry tracer
+        @param error_status: status given to set_status for the failed
+        calls, e.g. Status(StatusCode.ERROR); None marks them with an
+        "error" attribute instead
+        """
+        self.tracer = tracer
+        self.error_status = error_status
+
+    def __call__(self, spans):
+        for span in spans:
+            otel_span = self.tracer.start_span(span.name, start_time=span.start_time_unix_nano,
+                                               attributes=span.attributes())
+            if span.error:
+                if self.error_status is not None:
+                    otel_span.set_status(self.error_status)
+                else:
+                    otel_span.set_attribute("error", True)
+            otel_span.end(end_time=span.end_time_unix_nano)
+
+
+class Tracer(object):
+    """
+    Hands the spans of every session of the process to exporters, batch at
+    a time. Only one tracer can be started at once.
+    """
+    def __init__(self, exporters=(), batch=256, capacity=4096):
+        """
+        @param exporters: callables called with a list of L{Span}
+        @type exporters: sequence
+        @param batch: spans per exporter call
+        @type batch: int
+        @param capacity: events kept by the native ring buffer
+        @type capacity: int
+        """
+        self.exporters = list(exporters)
+        self.batch = batch
+        self.capacity = capacity
+        self.offset = 0
+
+    def start(self):
+        logging.debug("Tracer.start")
+        self.offset = clock_offset()
+        _libssh2.trace_enable(self._receive, self.batch, self.capacity)
+
+    def flush(self):
+        """
+        Exports the spans waiting for a full batch.
+        """
+        logging.debug("Tracer.flush")
+        self._receive(_libssh2.trace_drain())
+
+    def stop(self):
+        """
+        Exports the pending spans and stops the recording.
+        """
+        logging.debug("Tracer.stop")
+        _libssh2.trace_disable()
+
+    @property
+    def dropped(self):
+        """
+        Number of events lost because the exporters did not keep up.
+        """
+        return _libssh2.trace_dropped()
+
+    def _receive(self, events):
+        if not events:
+            return
+        spans = [Span(event, self.offset) for event in events]
+        for exporter in self.exporters:
+            exporter(spans)
@@ -0,0 +1,221 @@
+#
+# pylibssh2 - python bindings for libssh2 library
+#
+# Copyright (C) 2010 Wallix Inc.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by the
+# Free Software Foundation; either version 2.1 of the License, or (at your
+# option) any later version.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+# details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+#
+from collections import deque
+import logging
+import os
+import sys
+import threading
+import time
+"""
+Parallel transfer of a set of files over several L{Session} objects
+"""
+
+DOWNLOAD = "download"
+UPLOAD = "upload"
+
+
+class TransferResult(object):
+    """
+    Outcome of one file transfer.
+    """
+    def __init__(self, src, dst, size):
+        self.src = src
+        self.dst = dst
+        self.size = size
+        self.start = None
+        self.end = None
+        self.error = None
+
+    @property
+    def latency(self):
+        """
+        Duration of the transfer in seconds, None if it never started.
+        """
+        if self.start is None or self.end is None:
+            return None
+        return self.end - self.start
+
+
+class TransferReport(object):
+    """
+    Aggregate outcome of L{TransferManager.run}.
+    """
+    def __init__(self, results, elapsed):
+        self.results = results
+        self.elapsed = elapsed
+        self.errors = [result for result in results if result.error is not None]
+        self.bytes = sum(result.size for result in results if result.error is None)
+
+    @property
+    def throughput(self):
+        """
+        Bytes per second over the whole run.
+        """
+        if self.elapsed <= 0:
+            return 0.0
+        return self.bytes / self.elapsed
+
+    def latency(self, percentile):
+        """
+        Per-file latency, in seconds, at percentile (0-100).
+        """
+        latencies = sorted(result.latency for result in self.results
+                           if result.latency is not None)
+        if not latencies:
+            return 0.0
+        index = int(round(percentile / 100.0 * (len(latencies) - 1)))
+        return latencies[index]
+
+    def __str__(self):
+        return "%d files, %d bytes in %.3fsec (%.1f KB/s), latency p50 %.4fsec p90 %.4fsec max %.4fsec, %d errors" % (
+            len(self.results), self.bytes, self.elapsed, self.throughput / 1024.0,
+            self.latency(50), self.latency(90), self.latency(100), len(self.errors))
+
+
+class TransferManager(object):
+    """
+    Spreads a list of transfers over K authenticated sessions, one worker
+    thread per session. Each worker has its own queue, filled largest file
+    first; a worker that runs dry steals the smallest pending file of the
+    busiest queue. The transfers use the native scp_*_fd or pipelined SFTP
+    paths, which run without the GIL.
+
+        manager = TransferManager(sessions, DOWNLOAD)
+        report = manager.run([("/remote/a", "a"), ("/remote/b", "b")])
+        print report
+    """
+    def __init__(self, sessions, direction=DOWNLOAD, protocol="scp", pipeline_depth=16):
+        """
+        @param sessions: authenticated sessions, used by one thread each
+        @type sessions: list of L{Session}
+        @param direction: DOWNLOAD or UPLOAD
+        @type direction: str
+        @param protocol: "scp" or "sftp"
+        @type protocol: str
+        @param pipeline_depth: requests in flight for SFTP transfers
+        @type pipeline_depth: int
+        """
+        if direction not in (DOWNLOAD, UPLOAD):
+            raise ValueError("direction must be DOWNLOAD or UPLOAD")
+        if protocol not in ("scp", "sftp"):
+            raise ValueError("protocol must be scp or sftp")
+        if not sessions:
+            raise ValueError("sessions must not be empty")
+        self.sessions = sessions
+        self.direction = direction
+        self.protocol = protocol
+        self.pipeline_depth = pipeline_depth
+        self._lock = threading.Lock()
+        self._queues = []
+        # errors of the workers that could not start
+        self._failures = []
+
+    def run(self, transfers):
+        """
+        Transfers every (src, dst) or (src, dst, size) item. Without a size,
+        uploads use the local file size and downloads count as 0 for the
+        initial balancing.
+
+        @return: per-file results and aggregate numbers
+        @rtype: L{TransferReport}
+        """
+        logging.debug("TransferManager.run")
+        results = []
+        for transfer in transfers:
+            if len(transfer) > 2:
+                size = transfer[2]
+            elif self.direction == UPLOAD:
+                size = os.stat(transfer[0]).st_size
+            else:
+                size = 0
+            results.append(TransferResult(transfer[0], transfer[1], size))
+
+        self._queues = [deque() for session in self.sessions]
+        self._failures = []
+        ordered = sorted(results, key=lambda result: result.size, reverse=True)
+        for index, result in enumerate(ordered):
+            self._queues[index % len(self._queues)].append(result)
+
+        start = time.time()
+        workers = []
+        for index, session in enumerate(self.sessions):
+            worker = threading.Thread(target=self._work, args=(index, session))
+            worker.start()
+            workers.append(worker)
+        for worker in workers:
+            worker.join()
+        # left behind when every worker failed to start
+        for result in results:
+            if result.start is None and result.error is None:
+                result.error = self._failures and self._failures[-1] or \
+                    Exception("No session left to transfer %s" % (result.src,))
+
+        return TransferReport(results, time.time() - start)
+
+    def _next(self, index):
+        self._lock.acquire()
+        try:
+            if self._queues[index]:
+                return self._queues[index].popleft()
+            victim = max(self._queues, key=len)
+            if victim:
+                return victim.pop()
+            return None
+        finally:
+            self._lock.release()
+
+    def _work(self, index, session):
+        sftp = None
+        if self.protocol == "sftp":
+            try:
+                sftp = session.sftp_init()
+            except Exception:
+                # the other workers steal this queue
+                self._failures.append(sys.exc_info()[1])
+                logging.debug("TransferManager worker %d failed: %s" % (index, self._failures[-1]))
+                return
+        try:
+            while True:
+                result = self._next(index)
+                if result is None:
+                    break
+                result.start = time.time()
+                try:
+                    self._transfer(session, sftp, result)
+                except Exception:
+                    result.error = sys.exc_info()[1]
+                    logging.debug("TransferManager %s failed: %s" % (result.src, result.error))
+                result.end = time.time()
+        finally:
+            if sftp is not None:
+                session.sftp_shutdown(sftp)
+
+    def _transfer(self, session, sftp, result):
+        if self.direction == DOWNLOAD:
+            if sftp is None:
+                session.scp_recv_file(result.src, result.dst)
+            else:
+                sftp.get(result.src, result.dst, pipeline_depth=self.pipeline_depth)
+            result.size = os.stat(result.dst).st_size
+        else:
+            if sftp is None:
+                session.scp_send_file(result.src, result.dst)
+            else:
+                sftp.put(result.src, result.dst, pipeline_depth=self.pipeline_depth)
@@ -81,6 +81,9 @@ class Libssh2TestCommand(Command):
         from test_scp import SCPTest
         from test_sftp import SFTPTest
         from test_ssh import SSHTest
+        from test_channel import ChannelTest
+        from test_eventloop import EventLoopTest
+        from test_pool import SessionPoolTest
         from test_session_dealloc import DeallocSessionTest
         from test_sftp_dealloc import DeallocSftpTest
         from test_sftp_sub_dealloc import DeallocSftpSubTest
@@ -90,6 +93,9 @@ class Libssh2TestCommand(Command):
         suite.addTest(unittest.makeSuite(SCPTest))
         suite.addTest(unittest.makeSuite(SFTPTest))
         suite.addTest(unittest.makeSuite(SSHTest))
+        suite.addTest(unittest.makeSuite(ChannelTest))
+        suite.addTest(unittest.makeSuite(EventLoopTest))
+        suite.addTest(unittest.makeSuite(SessionPoolTest))
         suite.addTest(unittest.makeSuite(DeallocSessionTest))
         suite.addTest(unittest.makeSuite(DeallocSftpTest))
         suite.addTest(unittest.makeSuite(DeallocSftpSubTest))
@@ -40,6 +40,95 @@ Channel_close(PYLIBSSH2_CHANNEL *self)
 }
 /* }}} */
 
+/* {{{ channel_window_init
+ */
+void
+channel_window_init(PYLIBSSH2_WINDOW *window, LIBSSH2_CHANNEL *channel,
+                    unsigned long max, unsigned PY_LONG_LONG rtt_ns)
+{
+    unsigned long initial = 0;
+
+    memset(window, 0, sizeof(*window));
+    if (max == 0) {
+        return;
+    }
+
+    libssh2_channel_window_read_ex(channel, NULL, &initial);
+    window->max = max < PYLIBSSH2_WINDOW_LIMIT ? max : PYLIBSSH2_WINDOW_LIMIT;
+    window->target = initial;
+    window->rtt_ns = rtt_ns ? rtt_ns : PYLIBSSH2_WINDOW_RTT_NS;
+    window->sample_start = stats_now();
+}
+/* }}} */
+
+/* {{{ channel_window_tune
+ */
+void
+channel_window_tune(PYLIBSSH2_WINDOW *window, LIBSSH2_CHANNEL *channel, size_t bytes)
+{
+    unsigned PY_LONG_LONG now;
+    unsigned PY_LONG_LONG elapsed;
+    double wanted;
+    unsigned long avail;
+
+    if (window->max == 0) {
+        return;
+    }
+
+    now = stats_now();
+    window->sample_bytes += bytes;
+    elapsed = now - window->sample_start;
+    if (elapsed >= window->rtt_ns) {
+        /* a round trip worth of data is in flight while the adjust travels */
+        wanted = 2.0 * window->sample_bytes * window->rtt_ns / elapsed;
+        if (wanted > window->target) {
+            window->target = wanted < window->max ? (unsigned long)wanted : window->max;
+        }
+        window->sample_start = now;
+        window->sample_bytes = 0;
+    }
+
+    /* refilled by halves, as libssh2 does for its own window */
+    avail = libssh2_channel_window_read_ex(channel, NULL, NULL);
+    if (avail < window->target / 2) {
+        libssh2_channel_receive_window_adjust2(channel, window->target - avail, 1, NULL);
+    }
+}
+/* }}} */
+
+/* {{{ channel_stats_to_dict
+ */
+PyObject *
+channel_stats_to_dict(PYLIBSSH2_CHANNEL *self)
+{
+    PyObject *dict;
+    PyObject *window;
+    unsigned long avail = 0;
+    unsigned long initial = 0;
+
+    dict = stats_to_dict(&self->stats);
+    if (dict == NULL) {
+        return NULL;
+    }
+    if (self->channel != NULL) {
+        avail = libssh2_channel_window_read_ex(self->channel, NULL, &initial);
+    }
+    window = Py_BuildValue("{s:k,s:k,s:k,s:K}",
+                           "window", avail,
+                           "window_target", self->window.max ? self->window.target : initial,
+                           "window_max", self->window.max,
+                           "rtt_ns", self->window.rtt_ns);
+    if (window == NULL || PyDict_Update(dict, window) < 0) {
+        Py_XDECREF(window);
+        Py_DECREF(dict);
+        return NULL;
+    }
+    Py_DECREF(window);
+
+    return dict;
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Channel_pty
  */
 static char PYLIBSSH2_Channel_pty_doc[] = "\n\
@@ -108,6 +197,10 @@ PYLIBSSH2_Channel_pty(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_REQUEST_DENIED: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -177,6 +270,9 @@ PYLIBSSH2_Channel_pty_resize(PYLIBSSH2_CHANNEL *self, PyObject *args)
             errmsg = "";
         }
         switch(rc) {
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -230,6 +326,10 @@ PYLIBSSH2_Channel_shell(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_REQUEST_DENIED: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -292,6 +392,10 @@ PYLIBSSH2_Channel_execute(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_REQUEST_DENIED: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -357,6 +461,10 @@ PYLIBSSH2_Channel_setenv(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_REQUEST_DENIED: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -421,6 +529,8 @@ PYLIBSSH2_Channel_read(PYLIBSSH2_CHANNEL *self, PyObject *args)
     int rc = 0;
     int buffer_size= 1024;
     char * cbuf;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->channel == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Channel object has been closed/shutdown.");
@@ -438,9 +548,15 @@ PYLIBSSH2_Channel_read(PYLIBSSH2_CHANNEL *self, PyObject *args)
             return NULL;
         }
 
+        start = stats_now();
         Py_BEGIN_ALLOW_THREADS
         rc = libssh2_channel_read(self->channel, cbuf, buffer_size);
+        end = stats_now();
+        if (rc > 0) {
+            channel_window_tune(&self->window, self->channel, rc);
+        }
         Py_END_ALLOW_THREADS
+        stats_record(&self->stats, self->session, PYLIBSSH2_OP_READ, NULL, start, end, rc, rc > 0 ? rc : 0, 0);
 
         if(rc >= 0) {
             PyObject* returnObj = PyByteArray_FromStringAndSize(cbuf, rc);
@@ -464,6 +580,10 @@ PYLIBSSH2_Channel_read(PYLIBSSH2_CHANNEL *self, PyObject *args)
                     PyErr_Format(PYLIBSSH2_Error, "The channel has been closed: %s", errmsg);
                     return NULL;
 
+                case LIBSSH2_ERROR_EAGAIN:
+                    set_would_block(self->session, errmsg);
+                    return NULL;
+
                 default:
                     PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                     return NULL;
@@ -501,6 +621,8 @@ PYLIBSSH2_Channel_read_ex(PYLIBSSH2_CHANNEL *self, PyObject *args)
     /* buffer to read as a python object */
     PyObject *buffer;
     char * cbuf;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->channel == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Channel object has been closed/shutdown.");
@@ -516,9 +638,15 @@ PYLIBSSH2_Channel_read_ex(PYLIBSSH2_CHANNEL *self, PyObject *args)
     }
     cbuf = PyString_AsString(buffer);
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_channel_read_ex(self->channel, stream_id, cbuf, buffer_size);
+    end = stats_now();
+    if (rc > 0) {
+        channel_window_tune(&self->window, self->channel, rc);
+    }
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_READ, NULL, start, end, rc, rc > 0 ? rc : 0, 0);
 
     if (rc > 0) {
        if (rc != buffer_size && _PyString_Resize(&buffer, rc) < 0)
@@ -540,6 +668,10 @@ PYLIBSSH2_Channel_read_ex(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "The channel has been closed: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -553,6 +685,133 @@ PYLIBSSH2_Channel_read_ex(PYLIBSSH2_CHANNEL *self, PyObject *args)
 }
 /* }}} */
 
+/* {{{ channel_read_into
+ */
+static PyObject *
+channel_read_into(PYLIBSSH2_CHANNEL *self, PyObject *obj, int stream_id)
+{
+    int rc;
+    Py_buffer view;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if (get_writable_buffer(obj, &view) < 0) {
+        return NULL;
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    rc = libssh2_channel_read_ex(self->channel, stream_id, view.buf, view.len);
+    end = stats_now();
+    if (rc > 0) {
+        channel_window_tune(&self->window, self->channel, rc);
+    }
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_READ, NULL, start, end, rc, rc > 0 ? rc : 0, 0);
+
+    PyBuffer_Release(&view);
+
+    if (rc < 0) {
+        char *errmsg;
+        if(libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            // This is not the error that failed, do not take the string.
+            errmsg = "";
+        }
+        switch(rc) {
+            case LIBSSH2_ERROR_SOCKET_SEND:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to send data on socket: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_CHANNEL_CLOSED:
+                PyErr_Format(PYLIBSSH2_Error, "The channel has been closed: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PyInt_FromLong(rc);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Channel_readinto
+ */
+static char PYLIBSSH2_Channel_readinto_doc[] = "\n\
+readinto(buffer) -> int\n\
+\n\
+Reads at most len(buffer) bytes on the channel directly into buffer,\n\
+which can be any writable buffer object (bytearray, memoryview, mmap...).\n\
+\n\
+@param buffer: storage for the bytes read\n\
+@type  buffer: writable buffer\n\
+\n\
+@return number of bytes read, 0 on end of file\n\
+@rtype  int";
+
+static PyObject *
+PYLIBSSH2_Channel_readinto(PYLIBSSH2_CHANNEL *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    PyObject *obj;
+
+    if(self->channel == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Channel object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "O:readinto", &obj)) {
+        return NULL;
+    }
+
+    if (libssh2_channel_eof(self->channel) == 1) {
+        return PyInt_FromLong(0);
+    }
+
+    return channel_read_into(self, obj, 0);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Channel_read_ex_into
+ */
+static char PYLIBSSH2_Channel_read_ex_into_doc[] = "\n\
+read_ex_into(buffer, [stream_id]) -> int\n\
+\n\
+Reads at most len(buffer) bytes of a substream directly into buffer.\n\
+\n\
+@param buffer: storage for the bytes read\n\
+@type  buffer: writable buffer\n\
+@param stream_id: substream ID number\n\
+@type  stream_id: int\n\
+\n\
+@return number of bytes read\n\
+@rtype  int";
+
+static PyObject *
+PYLIBSSH2_Channel_read_ex_into(PYLIBSSH2_CHANNEL *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    PyObject *obj;
+    int stream_id = 0;
+
+    if(self->channel == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Channel object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "O|i:read_ex_into", &obj, &stream_id)) {
+        return NULL;
+    }
+
+    return channel_read_into(self, obj, stream_id);
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Channel_write
  */
 static char PYLIBSSH2_Channel_write_doc[] = "\n\
@@ -573,6 +832,8 @@ PYLIBSSH2_Channel_write(PYLIBSSH2_CHANNEL *self, PyObject *args)
     int rc;
     char *message;
     int message_len;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->channel == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Channel object has been closed/shutdown.");
@@ -583,9 +844,12 @@ PYLIBSSH2_Channel_write(PYLIBSSH2_CHANNEL *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_channel_write(self->channel, message, message_len);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_WRITE, NULL, start, end, rc, 0, rc > 0 ? rc : 0);
 
     if (rc < 0) {
         char *errmsg;
@@ -610,6 +874,10 @@ PYLIBSSH2_Channel_write(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "The channel has been requested to be closed: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -650,7 +918,7 @@ PYLIBSSH2_Channel_flush(PYLIBSSH2_CHANNEL *self, PyObject *args)
         }
         switch(rc) {
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_SetString(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block.");
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -757,6 +1025,10 @@ PYLIBSSH2_Channel_send_eof(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "Unable to send data on socket.: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -798,7 +1070,7 @@ PYLIBSSH2_Channel_wait_eof(PYLIBSSH2_CHANNEL *self, PyObject *args)
         }
         switch(rc) {
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, ": %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -845,7 +1117,7 @@ PYLIBSSH2_Channel_wait_closed(PYLIBSSH2_CHANNEL *self, PyObject *args)
         }
         switch(rc) {
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, ": %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -982,6 +1254,10 @@ PYLIBSSH2_Channel_x11_req(PYLIBSSH2_CHANNEL *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_REQUEST_DENIED: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -1031,6 +1307,181 @@ PYLIBSSH2_Channel_poll_read(PYLIBSSH2_CHANNEL *self, PyObject *args)
 /* }}} */
 
 
+/* {{{ PYLIBSSH2_Channel_stream
+ */
+static char PYLIBSSH2_Channel_stream_doc[] = "\n\
+stream([on_stdout, on_stderr, chunk]) -> int\n\
+\n\
+Reads stdout and stderr until the command running on the channel ends.\n\
+The channel is drained in non-blocking mode and the GIL is released while\n\
+waiting on the session socket, so waiting costs no CPU. The callbacks are\n\
+called with a memoryview of at most chunk bytes each time data arrives;\n\
+the memoryview is over a buffer reused by the next call, copy what must\n\
+be kept. The data of a stream without callback is dropped. The session\n\
+is back in its blocking mode on return.\n\
+\n\
+@param  on_stdout: called with the data read on stdout\n\
+@type   on_stdout: callable\n\
+@param  on_stderr: called with the data read on stderr\n\
+@type   on_stderr: callable\n\
+@param  chunk: size of the buffer\n\
+@type   chunk: int\n\
+\n\
+@return exit status of the command\n\
+@rtype  int";
+
+static PyObject *
+PYLIBSSH2_Channel_stream(PYLIBSSH2_CHANNEL *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    PyObject *on_stdout = Py_None;
+    PyObject *on_stderr = Py_None;
+    PyObject *callback;
+    PyObject *buffer;
+    PyObject *view;
+    PyObject *data;
+    PyObject *ret;
+    char *cbuf;
+    int chunk = 64 * 1024;
+    int fd, blocking, timeout, eof, got, stream_id;
+    int rc = 0, failed = 0;
+    unsigned PY_LONG_LONG bytes_read = 0;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if(self->channel == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Channel object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "|OOi:stream", &on_stdout, &on_stderr, &chunk)) {
+        return NULL;
+    }
+    if ((on_stdout != Py_None && !PyCallable_Check(on_stdout)) ||
+        (on_stderr != Py_None && !PyCallable_Check(on_stderr))) {
+        PyErr_SetString(PyExc_TypeError, "callbacks must be callable");
+        return NULL;
+    }
+    if (chunk <= 0) {
+        PyErr_SetString(PyExc_ValueError, "chunk must be positive");
+        return NULL;
+    }
+
+    fd = PYLIBSSH2_Session_fileno(self->session);
+    if (fd < 0) {
+        PyErr_SetString(PYLIBSSH2_Error, "Unable to find the socket of the session.");
+        return NULL;
+    }
+
+    /* the views handed out keep the buffer alive and stop any resize */
+    buffer = PyByteArray_FromStringAndSize(NULL, chunk);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    view = PyMemoryView_FromObject(buffer);
+    if (view == NULL) {
+        Py_DECREF(buffer);
+        return NULL;
+    }
+    cbuf = PyByteArray_AS_STRING(buffer);
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    blocking = libssh2_session_get_blocking(self->session);
+    timeout = libssh2_session_get_timeout(self->session);
+    libssh2_session_set_blocking(self->session, 0);
+
+    while (!failed) {
+        /* once eof is seen everything sent before it is queued */
+        eof = libssh2_channel_eof(self->channel);
+        got = 0;
+        for (stream_id = 0; stream_id <= SSH_EXTENDED_DATA_STDERR && !failed; stream_id++) {
+            callback = stream_id == 0 ? on_stdout : on_stderr;
+            while ((rc = libssh2_channel_read_ex(self->channel, stream_id, cbuf, chunk)) > 0) {
+                bytes_read += rc;
+                got = 1;
+                channel_window_tune(&self->window, self->channel, rc);
+                if (callback == Py_None) {
+                    continue;
+                }
+                Py_BLOCK_THREADS
+                /* the callback may use the session */
+                libssh2_session_set_blocking(self->session, blocking);
+                data = PySequence_GetSlice(view, 0, rc);
+                ret = data ? PyObject_CallFunctionObjArgs(callback, data, NULL) : NULL;
+                Py_XDECREF(data);
+                if (ret == NULL) {
+                    failed = 1;
+                }
+                Py_XDECREF(ret);
+                libssh2_session_set_blocking(self->session, 0);
+                Py_UNBLOCK_THREADS
+                if (failed) {
+                    break;
+                }
+            }
+            if (rc < 0 && rc != LIBSSH2_ERROR_EAGAIN) {
+                failed = 1;
+            }
+        }
+        if (failed || eof) {
+            break;
+        }
+        /* the packets read for one stream may bring data for the other or the eof */
+        if (got || libssh2_poll_channel_read(self->channel, 0) ||
+            libssh2_channel_eof(self->channel)) {
+            continue;
+        }
+        if (wait_socket(fd, self->session, timeout ? timeout : -1) == 0) {
+            rc = LIBSSH2_ERROR_SOCKET_TIMEOUT;
+            failed = 1;
+        }
+    }
+
+    while (!failed && (rc = libssh2_channel_wait_closed(self->channel)) == LIBSSH2_ERROR_EAGAIN) {
+        if (wait_socket(fd, self->session, timeout ? timeout : -1) == 0) {
+            rc = LIBSSH2_ERROR_SOCKET_TIMEOUT;
+            break;
+        }
+    }
+
+    libssh2_session_set_blocking(self->session, blocking);
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_EXEC, NULL, start, end,
+                 rc == LIBSSH2_ERROR_EAGAIN ? 0 : rc, bytes_read, 0);
+
+    Py_DECREF(view);
+    Py_DECREF(buffer);
+
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+    if (rc < 0) {
+        char *errmsg;
+        if(libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            // This is not the error that failed, do not take the string.
+            errmsg = "";
+        }
+        switch(rc) {
+            case LIBSSH2_ERROR_SOCKET_TIMEOUT:
+                PyErr_Format(PYLIBSSH2_Error, "Timed out reading the channel.");
+                return NULL;
+
+            case LIBSSH2_ERROR_CHANNEL_CLOSED:
+                PyErr_Format(PYLIBSSH2_Error, "The channel has been closed: %s", errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PyInt_FromLong(libssh2_channel_get_exit_status(self->channel));
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Channel_receive_window_adjust
  */
 static char PYLIBSSH2_Channel_receive_window_adjust_doc[] = "\n\
@@ -1075,6 +1526,28 @@ PYLIBSSH2_Channel_receive_window_adjust(PYLIBSSH2_CHANNEL *self, PyObject *args)
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Channel_stats
+ */
+static char PYLIBSSH2_Channel_stats_doc[] = "\n\
+stats() -> dict\n\
+\n\
+Returns the counters of the libssh2 calls made on this channel object:\n\
+calls, bytes_read, bytes_written, eagain, errors and blocked_ns, the time\n\
+spent inside libssh2 in nanoseconds. window is the receive window left to\n\
+the peer, window_target the window kept open, window_max its tuning limit\n\
+(0 when tuning is off) and rtt_ns the round trip used by the tuning.\n\
+\n\
+@return counters since the object was created, and its id in the traces\n\
+@rtype  dict";
+
+static PyObject *
+PYLIBSSH2_Channel_stats(PYLIBSSH2_CHANNEL *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    return channel_stats_to_dict(self);
+}
+/* }}} */
+
 
 /* {{{ PYLIBSSH2_Channel_methods[]
  *
@@ -1096,6 +1569,8 @@ static PyMethodDef PYLIBSSH2_Channel_methods[] =
     ADD_METHOD(setblocking),
     ADD_METHOD(read_ex),
     ADD_METHOD(read),
+    ADD_METHOD(readinto),
+    ADD_METHOD(read_ex_into),
     ADD_METHOD(write),
     ADD_METHOD(flush),
     ADD_METHOD(eof),
@@ -1106,8 +1581,10 @@ static PyMethodDef PYLIBSSH2_Channel_methods[] =
     ADD_METHOD(window_read),
     ADD_METHOD(window_write),
     ADD_METHOD(poll_read),
+    ADD_METHOD(stream),
     ADD_METHOD(x11_req),
     ADD_METHOD(receive_window_adjust),
+    ADD_METHOD(stats),
     { NULL, NULL }
 };
 #undef ADD_METHOD
@@ -1132,6 +1609,8 @@ PYLIBSSH2_Channel_New(LIBSSH2_SESSION *session, LIBSSH2_CHANNEL *channel)
 
     self->session = session;
     self->channel = channel;
+    stats_init(&self->stats);
+    memset(&self->window, 0, sizeof(self->window));
 
     return self;
 }
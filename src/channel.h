@@ -23,6 +23,7 @@
 
 #include <Python.h>
 #include <libssh2.h>
+#include "stats.h"
 
 extern int init_libssh2_Channel(PyObject *);
 
@@ -30,12 +31,53 @@ extern PyTypeObject PYLIBSSH2_Channel_Type;
 
 #define PYLIBSSH2_Channel_Check(v) ((v)->ob_type == &PYLIBSSH2_Channel_Type)
 
+/* round trip assumed when the channel open could not be timed */
+#define PYLIBSSH2_WINDOW_RTT_NS     (200 * 1000000ULL)
+/* largest receive window a channel can be tuned to */
+#define PYLIBSSH2_WINDOW_LIMIT      0x7fffffffUL
+
+/*
+ * Receive window auto-tuning. Every round trip the bytes received are
+ * measured, and the window is grown to twice what arrived, up to max: a
+ * window-limited channel doubles its window each round trip until the
+ * link, or max, is the limit.
+ */
+typedef struct {
+    /* largest window granted, 0 when tuning is off */
+    unsigned long max;
+    /* window kept open for the peer */
+    unsigned long target;
+    /* time taken by the channel open, at least one round trip */
+    unsigned PY_LONG_LONG rtt_ns;
+    unsigned PY_LONG_LONG sample_start;
+    unsigned PY_LONG_LONG sample_bytes;
+} PYLIBSSH2_WINDOW;
+
 typedef struct {
     PyObject_HEAD
     LIBSSH2_SESSION *session;
     LIBSSH2_CHANNEL *channel;
+    PYLIBSSH2_STATS stats;
+    PYLIBSSH2_WINDOW window;
 } PYLIBSSH2_CHANNEL;
 
 extern void Channel_close(PYLIBSSH2_CHANNEL *self);
 
+/*
+ * Turn tuning on for channel, up to max bytes, rtt_ns being the duration of
+ * its open or 0 if unknown. A max of 0 leaves libssh2 with its fixed window.
+ */
+extern void channel_window_init(PYLIBSSH2_WINDOW *window, LIBSSH2_CHANNEL *channel,
+                                unsigned long max, unsigned PY_LONG_LONG rtt_ns);
+
+/*
+ * Account bytes just read on channel and grow its window if needed. Sends
+ * at most one window adjust, does not touch the GIL.
+ */
+extern void channel_window_tune(PYLIBSSH2_WINDOW *window, LIBSSH2_CHANNEL *channel,
+                                size_t bytes);
+
+/* stats of the channel with its receive window */
+extern PyObject *channel_stats_to_dict(PYLIBSSH2_CHANNEL *self);
+
 #endif /* _PYLIBSSH2_CHANNEL_H_ */
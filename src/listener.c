@@ -62,7 +62,7 @@ PYLIBSSH2_Listener_accept(PYLIBSSH2_LISTENER *self, PyObject *args)
                 return NULL;
 
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block: %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
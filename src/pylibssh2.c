@@ -40,6 +40,7 @@ method on the session instance.\n\
 /* }}} */
 
 PyObject *PYLIBSSH2_Error;
+PyObject *PYLIBSSH2_WouldBlock;
 
 /* {{{ PYLIBSSH2_Session
  */
@@ -80,10 +81,208 @@ PYLIBSSH2_Session(PyObject *self, PyObject *args)
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_histograms_enable
+ */
+PyDoc_STRVAR(PYLIBSSH2_histograms_enable_doc,
+"\n\
+histograms_enable([enabled]) -> bool\n\
+\n\
+Starts or stops recording the duration of the blocking libssh2 calls in\n\
+the per-operation histograms returned by histograms(). Off by default.\n\
+\n\
+@param  enabled: True to record, False to stop (default True)\n\
+@type   enabled: bool\n\
+\n\
+@return previous state\n\
+@rtype  bool");
+
+static PyObject *
+PYLIBSSH2_histograms_enable(PyObject *self, PyObject *args)
+{
+    PyObject *enabled = Py_True;
+    int previous = stats_histograms_enabled;
+    int rc;
+
+    if (!PyArg_ParseTuple(args, "|O:histograms_enable", &enabled)) {
+        return NULL;
+    }
+    rc = PyObject_IsTrue(enabled);
+    if (rc < 0) {
+        return NULL;
+    }
+    stats_histograms_enabled = rc;
+
+    return PyBool_FromLong(previous);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_histograms
+ */
+PyDoc_STRVAR(PYLIBSSH2_histograms_doc,
+"\n\
+histograms() -> dict\n\
+\n\
+Returns the latency histograms of the blocking libssh2 calls of every\n\
+session, one per operation: startup, auth, open_session, sftp_init,\n\
+sftp_open, read, write, stat, readdir and metadata. Calls that raised\n\
+WouldBlock are not recorded.\n\
+\n\
+@return {operation: {'count', 'sum_ns', 'min_ns', 'max_ns',\n\
+                     'buckets': [(lower_ns, upper_ns, count), ...]}}\n\
+with the non-empty buckets in increasing order, bounds included\n\
+@rtype  dict");
+
+static PyObject *
+PYLIBSSH2_histograms(PyObject *self, PyObject *args)
+{
+    return stats_histograms_to_dict();
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_histograms_reset
+ */
+PyDoc_STRVAR(PYLIBSSH2_histograms_reset_doc,
+"\n\
+histograms_reset()\n\
+\n\
+Empties the latency histograms.");
+
+static PyObject *
+PYLIBSSH2_histograms_reset(PyObject *self, PyObject *args)
+{
+    stats_histograms_reset();
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_trace_enable
+ */
+PyDoc_STRVAR(PYLIBSSH2_trace_enable_doc,
+"\n\
+trace_enable([callback, batch, capacity])\n\
+\n\
+Starts recording one event per SFTP, SCP, channel and session call: the\n\
+operation, the object and session ids (see stats()), the remote path if\n\
+any, the start and end times on the trace_clock() clock, the libssh2\n\
+return code and the bytes read and written. The events are kept in a ring\n\
+of capacity events; when callback is given, it is called with a list of\n\
+batch events at a time, otherwise trace_drain() returns them. Events that\n\
+do not fit in the ring are counted by trace_dropped().\n\
+\n\
+@param  callback: called with a list of events, or None\n\
+@type   callback: callable\n\
+@param  batch: events per callback call (default 256)\n\
+@type   batch: int\n\
+@param  capacity: size of the ring, rounded up to a power of two (default 4096)\n\
+@type   capacity: int");
+
+static PyObject *
+PYLIBSSH2_trace_enable(PyObject *self, PyObject *args)
+{
+    PyObject *callback = Py_None;
+    int batch = PYLIBSSH2_TRACE_BATCH;
+    int capacity = PYLIBSSH2_TRACE_CAPACITY;
+
+    if (!PyArg_ParseTuple(args, "|Oii:trace_enable", &callback, &batch, &capacity)) {
+        return NULL;
+    }
+    if (callback != Py_None && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable or None");
+        return NULL;
+    }
+    if (trace_start(callback, batch, capacity) < 0) {
+        return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_trace_disable
+ */
+PyDoc_STRVAR(PYLIBSSH2_trace_disable_doc,
+"\n\
+trace_disable()\n\
+\n\
+Hands the pending events to the callback, if any, and stops recording.\n\
+Without a callback, the pending events stay available to trace_drain().");
+
+static PyObject *
+PYLIBSSH2_trace_disable(PyObject *self, PyObject *args)
+{
+    trace_stop();
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_trace_drain
+ */
+PyDoc_STRVAR(PYLIBSSH2_trace_drain_doc,
+"\n\
+trace_drain() -> list\n\
+\n\
+Removes the pending events from the ring.\n\
+\n\
+@return [(operation, id, session_id, path, start_ns, end_ns, rc,\n\
+          bytes_read, bytes_written), ...] oldest first\n\
+@rtype  list");
+
+static PyObject *
+PYLIBSSH2_trace_drain(PyObject *self, PyObject *args)
+{
+    return trace_drain();
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_trace_dropped
+ */
+PyDoc_STRVAR(PYLIBSSH2_trace_dropped_doc,
+"\n\
+trace_dropped() -> long\n\
+\n\
+@return number of events lost because the ring was full\n\
+@rtype  long");
+
+static PyObject *
+PYLIBSSH2_trace_dropped(PyObject *self, PyObject *args)
+{
+    return PyLong_FromUnsignedLongLong(trace_dropped);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_trace_clock
+ */
+PyDoc_STRVAR(PYLIBSSH2_trace_clock_doc,
+"\n\
+trace_clock() -> long\n\
+\n\
+@return current time of the monotonic clock of the events, in nanoseconds\n\
+@rtype  long");
+
+static PyObject *
+PYLIBSSH2_trace_clock(PyObject *self, PyObject *args)
+{
+    return PyLong_FromUnsignedLongLong(stats_now());
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_methods[]
  */
 static PyMethodDef PYLIBSSH2_methods[] = {
     { "Session", (PyCFunction)PYLIBSSH2_Session, METH_VARARGS, PYLIBSSH2_Session_doc },
+    { "histograms_enable", (PyCFunction)PYLIBSSH2_histograms_enable, METH_VARARGS, PYLIBSSH2_histograms_enable_doc },
+    { "histograms", (PyCFunction)PYLIBSSH2_histograms, METH_NOARGS, PYLIBSSH2_histograms_doc },
+    { "histograms_reset", (PyCFunction)PYLIBSSH2_histograms_reset, METH_NOARGS, PYLIBSSH2_histograms_reset_doc },
+    { "trace_enable", (PyCFunction)PYLIBSSH2_trace_enable, METH_VARARGS, PYLIBSSH2_trace_enable_doc },
+    { "trace_disable", (PyCFunction)PYLIBSSH2_trace_disable, METH_NOARGS, PYLIBSSH2_trace_disable_doc },
+    { "trace_drain", (PyCFunction)PYLIBSSH2_trace_drain, METH_NOARGS, PYLIBSSH2_trace_drain_doc },
+    { "trace_dropped", (PyCFunction)PYLIBSSH2_trace_dropped, METH_NOARGS, PYLIBSSH2_trace_dropped_doc },
+    { "trace_clock", (PyCFunction)PYLIBSSH2_trace_clock, METH_NOARGS, PYLIBSSH2_trace_clock_doc },
     { NULL, NULL }
 };
 /* }}} */
@@ -115,6 +314,8 @@ init_libssh2(void)
     PYLIBSSH2_API[PYLIBSSH2_Sftp_New_NUM] = (void *) PYLIBSSH2_Sftp_New;
     PYLIBSSH2_API[PYLIBSSH2_Sftpfile_New_NUM] = (void *) PYLIBSSH2_Sftpfile_New;
     PYLIBSSH2_API[PYLIBSSH2_Sftpdir_New_NUM] = (void *) PYLIBSSH2_Sftpdir_New;
+    PYLIBSSH2_API[PYLIBSSH2_SftpAttributes_New_NUM] = (void *) PYLIBSSH2_SftpAttributes_New;
+    PYLIBSSH2_API[PYLIBSSH2_Trace_SetCallback_NUM] = (void *) PYLIBSSH2_Trace_SetCallback;
 
     c_api_object = PyCObject_FromVoidPtr((void *)PYLIBSSH2_API, NULL);
     if (c_api_object != NULL) {
@@ -133,6 +334,18 @@ init_libssh2(void)
         goto error;
     }
 
+    PYLIBSSH2_WouldBlock = PyErr_NewException(
+        PYLIBSSH2_MODULE_NAME".WouldBlock",
+        PYLIBSSH2_Error,
+        NULL
+    );
+    if (PYLIBSSH2_WouldBlock == NULL) {
+        goto error;
+    }
+    if (PyModule_AddObject(module, "WouldBlock", PYLIBSSH2_WouldBlock) != 0) {
+        goto error;
+    }
+
     PyModule_AddIntConstant(module, "FINGERPRINT_MD5", 0x0000);
     PyModule_AddIntConstant(module, "FINGERPRINT_SHA1", 0x0001);
     PyModule_AddIntConstant(module, "FINGERPRINT_HEX", 0x0000);
@@ -157,6 +370,15 @@ init_libssh2(void)
     PyModule_AddStringConstant(module, "DEFAULT_BANNER", LIBSSH2_SSH_DEFAULT_BANNER"_Python");
     PyModule_AddStringConstant(module, "LIBSSH2_VERSION", LIBSSH2_VERSION);
 
+    PyModule_AddIntConstant(module, "SESSION_BLOCK_INBOUND", LIBSSH2_SESSION_BLOCK_INBOUND);
+    PyModule_AddIntConstant(module, "SESSION_BLOCK_OUTBOUND", LIBSSH2_SESSION_BLOCK_OUTBOUND);
+
+    PyModule_AddIntConstant(module, "POLLFD_POLLIN", LIBSSH2_POLLFD_POLLIN);
+    PyModule_AddIntConstant(module, "POLLFD_POLLEXT", LIBSSH2_POLLFD_POLLEXT);
+    PyModule_AddIntConstant(module, "POLLFD_POLLOUT", LIBSSH2_POLLFD_POLLOUT);
+    PyModule_AddIntConstant(module, "POLLFD_SESSION_CLOSED", LIBSSH2_POLLFD_SESSION_CLOSED);
+    PyModule_AddIntConstant(module, "POLLFD_CHANNEL_CLOSED", LIBSSH2_POLLFD_CHANNEL_CLOSED);
+
     PyModule_AddIntConstant(module, "CHANNEL_FLUSH_ALL", LIBSSH2_CHANNEL_FLUSH_ALL);
     PyModule_AddIntConstant(module, "CHANNEL_FLUSH_EXTENDED_DATA", LIBSSH2_CHANNEL_FLUSH_EXTENDED_DATA);
 
@@ -176,60 +398,77 @@ init_libssh2(void)
     if (!init_libssh2_Sftpdir(dict)) {
         goto error;
     }
+    if (!init_libssh2_SftpAttributes(dict)) {
+        goto error;
+    }
 
     error:
     ;
 }
 /* }}} */
 
-/* {{{ sftp_attrs_to_statdict
+/* {{{ get_writable_buffer
  */
-PyObject *
-sftp_attrs_to_statdict(LIBSSH2_SFTP_ATTRIBUTES *attr)
+int
+get_writable_buffer(PyObject *obj, Py_buffer *view)
 {
-    PyObject *attrs=NULL;
-
-    attrs = PyDict_New();
-    PyDict_SetItem(attrs, PyString_FromString("st_size"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->filesize));
-    PyDict_SetItem(attrs, PyString_FromString("st_uid"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->uid));
-    PyDict_SetItem(attrs, PyString_FromString("st_gid"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->gid));
-    PyDict_SetItem(attrs, PyString_FromString("st_mode"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->permissions));
-    PyDict_SetItem(attrs, PyString_FromString("st_atime"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->atime));
-    PyDict_SetItem(attrs, PyString_FromString("st_mtime"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->mtime));
-    PyDict_SetItem(attrs, PyString_FromString("st_flags"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->flags));
-
-    return attrs;
+    void *ptr;
+    Py_ssize_t len;
+
+    if (PyObject_CheckBuffer(obj)) {
+        return PyObject_GetBuffer(obj, view, PyBUF_WRITABLE);
+    }
+
+    /* mmap and array only speak the old buffer protocol in python 2 */
+    if (PyObject_AsWriteBuffer(obj, &ptr, &len) < 0) {
+        return -1;
+    }
+    return PyBuffer_FillInfo(view, obj, ptr, len, 0, PyBUF_WRITABLE);
 }
 /* }}} */
 
-
-/* {{{ stat_to_statdict
+/* {{{ get_readable_buffer
  */
-PyObject *
-stat_to_statdict(struct stat *attr){
-    PyObject *attrs=NULL;
+int
+get_readable_buffer(PyObject *obj, Py_buffer *view)
+{
+    const void *ptr;
+    Py_ssize_t len;
 
-    attrs = PyDict_New();
-    PyDict_SetItem(attrs, PyString_FromString("st_size"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->st_size));
-    PyDict_SetItem(attrs, PyString_FromString("st_uid"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->st_uid));
-    PyDict_SetItem(attrs, PyString_FromString("st_gid"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->st_gid));
-    PyDict_SetItem(attrs, PyString_FromString("st_mode"), PyLong_FromUnsignedLong(
-        (unsigned long)attr->st_mode));
-    PyDict_SetItem(attrs, PyString_FromString("st_atime"), PyFloat_FromDouble(
-        attr->st_atim.tv_sec + attr->st_mtim.tv_nsec * 0.000000001));
-    PyDict_SetItem(attrs, PyString_FromString("st_mtime"), PyFloat_FromDouble(
-        attr->st_mtim.tv_sec + attr->st_mtim.tv_nsec * 0.000000001));
+    if (PyObject_CheckBuffer(obj)) {
+        return PyObject_GetBuffer(obj, view, PyBUF_SIMPLE);
+    }
+
+    if (PyUnicode_Check(obj)) {
+        /* encoded like "s#" does, not the internal UCS-2/UCS-4 bytes */
+        obj = _PyUnicode_AsDefaultEncodedString(obj, NULL);
+        if (obj == NULL) {
+            return -1;
+        }
+        return PyBuffer_FillInfo(view, obj, PyString_AS_STRING(obj),
+                                 PyString_GET_SIZE(obj), 1, PyBUF_SIMPLE);
+    }
 
-    return attrs;
+    if (PyObject_AsReadBuffer(obj, &ptr, &len) < 0) {
+        return -1;
+    }
+    return PyBuffer_FillInfo(view, obj, (void *)ptr, len, 1, PyBUF_SIMPLE);
+}
+/* }}} */
+
+/* {{{ set_would_block
+ */
+void
+set_would_block(LIBSSH2_SESSION *session, const char *errmsg)
+{
+    PyObject *value;
+
+    /* the directions tell an event loop which readiness to wait for */
+    value = Py_BuildValue("(si)", errmsg ? errmsg : "",
+                          libssh2_session_block_directions(session));
+    if (value != NULL) {
+        PyErr_SetObject(PYLIBSSH2_WouldBlock, value);
+        Py_DECREF(value);
+    }
 }
 /* }}} */
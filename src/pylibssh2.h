@@ -30,9 +30,11 @@
 #include "channel.h"
 #include "listener.h"
 #include "sftp.h"
+#include "sftpattributes.h"
 #include "sftpfile.h"
 #include "sftpdir.h"
 #include "session.h"
+#include "trace.h"
 #include "util.h"
 
 /* pylibssh2 module version */
@@ -44,6 +46,9 @@
 /* Python module's Error */
 extern PyObject *PYLIBSSH2_Error;
 
+/* Error raised on LIBSSH2_ERROR_EAGAIN, args are (message, block directions) */
+extern PyObject *PYLIBSSH2_WouldBlock;
+
 #ifdef exception_from_error_queue
 #   undef exception_from_error_queue
 #endif
@@ -77,7 +82,15 @@ extern PyObject *PYLIBSSH2_Error;
 #define PYLIBSSH2_Listener_New_RETURN           PYLIBSSH2_LISTENER *
 #define PYLIBSSH2_Listener_New_PROTO            (LIBSSH2_SESSION*, LIBSSH2_LISTENER *)
 
-#define PYLIBSSH2_API_pointers                  6
+#define PYLIBSSH2_SftpAttributes_New_NUM        6
+#define PYLIBSSH2_SftpAttributes_New_RETURN     PYLIBSSH2_SFTPATTRIBUTES *
+#define PYLIBSSH2_SftpAttributes_New_PROTO      (LIBSSH2_SFTP_ATTRIBUTES *)
+
+#define PYLIBSSH2_Trace_SetCallback_NUM         7
+#define PYLIBSSH2_Trace_SetCallback_RETURN      int
+#define PYLIBSSH2_Trace_SetCallback_PROTO       (PYLIBSSH2_TRACE_CALLBACK, void *, int)
+
+#define PYLIBSSH2_API_pointers                  8
 
 #ifdef DEBUG
 extern FILE* logFile;
@@ -86,11 +99,22 @@ extern FILE* logFile;
 #define PRINTFUNCNAME
 #endif
 
-PyObject *
-sftp_attrs_to_statdict(LIBSSH2_SFTP_ATTRIBUTES *attr);
+/*
+ * Fill view with the memory of obj, through the new buffer protocol when
+ * available and the old one otherwise. Release with PyBuffer_Release.
+ */
+int
+get_writable_buffer(PyObject *obj, Py_buffer *view);
+
+/* unicode is encoded with the default encoding, like "s#" */
+int
+get_readable_buffer(PyObject *obj, Py_buffer *view);
 
-PyObject *
-stat_to_statdict(struct stat *attr);
+/*
+ * Raise WouldBlock with the current libssh2_session_block_directions.
+ */
+void
+set_would_block(LIBSSH2_SESSION *session, const char *errmsg);
 
 
 #ifdef PYLIBSSH2_MODULE
@@ -101,6 +125,8 @@ extern PYLIBSSH2_Sftp_New_RETURN        PYLIBSSH2_Sftp_New        PYLIBSSH2_Sftp
 extern PYLIBSSH2_Sftpfile_New_RETURN    PYLIBSSH2_Sftpfile_New    PYLIBSSH2_Sftpfile_New_PROTO;
 extern PYLIBSSH2_Sftpdir_New_RETURN     PYLIBSSH2_Sftpdir_New     PYLIBSSH2_Sftpdir_New_PROTO;
 extern PYLIBSSH2_Listener_New_RETURN    PYLIBSSH2_Listener_New    PYLIBSSH2_Listener_New_PROTO;
+extern PYLIBSSH2_SftpAttributes_New_RETURN PYLIBSSH2_SftpAttributes_New PYLIBSSH2_SftpAttributes_New_PROTO;
+extern PYLIBSSH2_Trace_SetCallback_RETURN PYLIBSSH2_Trace_SetCallback PYLIBSSH2_Trace_SetCallback_PROTO;
 
 #else
 
@@ -19,6 +19,9 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 #include <Python.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #define PYLIBSSH2_MODULE
 #include "pylibssh2.h"
 
@@ -38,6 +41,8 @@ PYLIBSSH2_Session_startup(PYLIBSSH2_SESSION *self, PyObject *args)
     PRINTFUNCNAME
     int rc;
     int fd;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     PyObject *socket;
     if (!PyArg_ParseTuple(args, "O:startup", &socket)) {
@@ -48,9 +53,12 @@ PYLIBSSH2_Session_startup(PYLIBSSH2_SESSION *self, PyObject *args)
     self->socket = socket;
     fd = PyObject_AsFileDescriptor(self->socket);
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_session_startup(self->session, fd);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(NULL, self->session, PYLIBSSH2_OP_STARTUP, NULL, start, end, rc, 0, 0);
 
     if(rc < 0) {
         char *errmsg;
@@ -78,7 +86,7 @@ PYLIBSSH2_Session_startup(PYLIBSSH2_SESSION *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "An invalid SSH protocol response was received on the socket: %s", errmsg);
                 return NULL;
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block: %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Failure establishing startup %i: %s", rc, errmsg);
@@ -126,7 +134,7 @@ PYLIBSSH2_Session_set_banner(PYLIBSSH2_SESSION *self, PyObject *args)
                 PyErr_SetString(PYLIBSSH2_Error, " An internal memory allocation call failed.");
                 return NULL;
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_SetString(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block.");
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -270,7 +278,7 @@ PYLIBSSH2_Session_userauth_list(PYLIBSSH2_SESSION *self, PyObject *args)
                 return NULL;
 
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_SetString(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block.");
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -357,14 +365,19 @@ PYLIBSSH2_Session_userauth_password(PYLIBSSH2_SESSION *self, PyObject *args)
     int rc;
     char *username;
     char *password;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if (!PyArg_ParseTuple(args, "ss:userauth_password", &username, &password)) {
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_userauth_password(self->session, username, password);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(NULL, self->session, PYLIBSSH2_OP_AUTH, NULL, start, end, rc, 0, 0);
 
     if (rc < 0) {
         char *errmsg;
@@ -389,6 +402,10 @@ PYLIBSSH2_Session_userauth_password(PYLIBSSH2_SESSION *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "failed, invalid username/password or public/private key: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -426,16 +443,21 @@ PYLIBSSH2_Session_userauth_publickey_fromfile(PYLIBSSH2_SESSION *self, PyObject
     char *publickey;
     char *privatekey;
     char *passphrase = NULL;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if (!PyArg_ParseTuple(args, "sss|s:userauth_publickey_fromfile", &username,
                           &publickey, &privatekey, &passphrase)) {
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_userauth_publickey_fromfile(self->session, username, publickey,
                                              privatekey, passphrase);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(NULL, self->session, PYLIBSSH2_OP_AUTH, NULL, start, end, rc, 0, 0);
 
     if (rc) {
         char *errmsg;
@@ -465,7 +487,7 @@ PYLIBSSH2_Session_userauth_publickey_fromfile(PYLIBSSH2_SESSION *self, PyObject
                 return NULL;
 
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_SetString(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block.");
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -495,14 +517,19 @@ PYLIBSSH2_Session_userauth_hostbased_fromfile(PYLIBSSH2_SESSION *self, PyObject
     char *privatekey;
     char *hostname;
     char *passphrase = NULL;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if (!PyArg_ParseTuple(args, "ssss|s:userauth_publickey_fromfile", &username, &publickey, &privatekey, &hostname, &passphrase)) {
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_userauth_hostbased_fromfile(self->session, username, publickey,privatekey, passphrase, hostname);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(NULL, self->session, PYLIBSSH2_OP_AUTH, NULL, start, end, rc, 0, 0);
 
     if (rc) {
         char *errmsg;
@@ -532,7 +559,7 @@ PYLIBSSH2_Session_userauth_hostbased_fromfile(PYLIBSSH2_SESSION *self, PyObject
                 return NULL;
 
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_SetString(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block.");
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             case LIBSSH2_ERROR_FILE:
@@ -563,6 +590,8 @@ PYLIBSSH2_Session_userauth_agent(PYLIBSSH2_SESSION *self, PyObject *args)
     char *username;
     struct libssh2_agent_publickey *store = NULL;
     LIBSSH2_AGENT * agent = NULL;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if (!PyArg_ParseTuple(args, "s:userauth_agent", &username)) {
         return NULL;
@@ -575,8 +604,10 @@ PYLIBSSH2_Session_userauth_agent(PYLIBSSH2_SESSION *self, PyObject *args)
 
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_agent_connect(agent);
+    end = stats_now();
     Py_END_ALLOW_THREADS
 
     if (rc == 0) {
@@ -602,9 +633,12 @@ PYLIBSSH2_Session_userauth_agent(PYLIBSSH2_SESSION *self, PyObject *args)
 
         Py_BEGIN_ALLOW_THREADS
         libssh2_agent_disconnect(agent);
+        end = stats_now();
         Py_END_ALLOW_THREADS
     }
 
+    stats_record(NULL, self->session, PYLIBSSH2_OP_AUTH, NULL, start, end,
+                 PyErr_Occurred() ? LIBSSH2_ERROR_AUTHENTICATION_FAILED : rc, 0, 0);
     libssh2_agent_free(agent);
 
     if(PyErr_Occurred()) {
@@ -715,6 +749,9 @@ PYLIBSSH2_Session_session_method_pref(PYLIBSSH2_SESSION *self, PyObject *args)
             case LIBSSH2_ERROR_METHOD_NOT_SUPPORTED:
                 PyErr_SetString(PYLIBSSH2_Error, "The requested method is not supported.");
                 return NULL;
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i", rc);
                 return NULL;
@@ -726,13 +763,110 @@ PYLIBSSH2_Session_session_method_pref(PYLIBSSH2_SESSION *self, PyObject *args)
 }
 /* }}} */
 
+/* {{{ channel_open_rtt
+ */
+/*
+ * Duration of a channel open from start to end, which took at least one
+ * round trip, or 0 when the session does not block: the call that
+ * succeeded may only have read an answer already there.
+ */
+static unsigned PY_LONG_LONG
+channel_open_rtt(LIBSSH2_SESSION *session, unsigned PY_LONG_LONG start,
+                 unsigned PY_LONG_LONG end)
+{
+    if (!libssh2_session_get_blocking(session)) {
+        return 0;
+    }
+    return end - start;
+}
+/* }}} */
+
+/* {{{ channel_open_sizes
+ */
+/*
+ * Checks the window_size and packet_size given to open a channel, 0
+ * standing for the libssh2 default. libssh2 drops incoming packets larger
+ * than LIBSSH2_PACKET_MAXPAYLOAD, so the packet size cannot go past the
+ * default. Returns -1 with ValueError set when out of range.
+ */
+static int
+channel_open_sizes(unsigned long window_size, unsigned long packet_size,
+                   unsigned int *window, unsigned int *packet)
+{
+    if (window_size > PYLIBSSH2_WINDOW_LIMIT) {
+        PyErr_Format(PyExc_ValueError, "window_size must be at most %lu", PYLIBSSH2_WINDOW_LIMIT);
+        return -1;
+    }
+    if (packet_size > LIBSSH2_CHANNEL_PACKET_DEFAULT) {
+        PyErr_Format(PyExc_ValueError, "packet_size must be at most %d", LIBSSH2_CHANNEL_PACKET_DEFAULT);
+        return -1;
+    }
+    *window = window_size ? window_size : LIBSSH2_CHANNEL_WINDOW_DEFAULT;
+    *packet = packet_size ? packet_size : LIBSSH2_CHANNEL_PACKET_DEFAULT;
+    return 0;
+}
+/* }}} */
+
+/* {{{ store_u32
+ */
+/* writes value in network order at s, returns the byte after it */
+static unsigned char *
+store_u32(unsigned char *s, unsigned long value)
+{
+    s[0] = (value >> 24) & 0xff;
+    s[1] = (value >> 16) & 0xff;
+    s[2] = (value >> 8) & 0xff;
+    s[3] = value & 0xff;
+    return s + 4;
+}
+/* }}} */
+
+/* {{{ store_str
+ */
+/* writes an SSH string, its length then its bytes, returns the byte after it */
+static unsigned char *
+store_str(unsigned char *s, const char *str, size_t len)
+{
+    s = store_u32(s, len);
+    memcpy(s, str, len);
+    return s + len;
+}
+/* }}} */
+
+/* {{{ scp_window_open
+ */
+/*
+ * libssh2 opens the SCP channels with the default window, a larger
+ * window_size can only be granted once the channel is open.
+ */
+static void
+scp_window_open(LIBSSH2_CHANNEL *channel, unsigned long window_size)
+{
+    unsigned long avail;
+
+    avail = libssh2_channel_window_read_ex(channel, NULL, NULL);
+    if (window_size > avail) {
+        libssh2_channel_receive_window_adjust2(channel, window_size - avail, 1, NULL);
+    }
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Session_open_session
  */
 static char PYLIBSSH2_Session_open_session_doc[] = "\n\
-open_session() -> libssh2.Channel\n\
+open_session([max_window, window_size, packet_size]) -> libssh2.Channel\n\
 \n\
 Allocates a new channel for the current session.\n\
 \n\
+@param  max_window: when not 0, the receive window grows with the\n\
+                    measured throughput up to max_window bytes\n\
+@type   max_window: int\n\
+@param  window_size: initial receive window, 0 for the libssh2 default\n\
+@type   window_size: int\n\
+@param  packet_size: largest data packet the server may send, at most\n\
+                     32768, 0 for the libssh2 default\n\
+@type   packet_size: int\n\
+\n\
 @return new channel opened\n\
 @rtype  libssh2.Channel";
 
@@ -741,10 +875,31 @@ PYLIBSSH2_Session_open_session(PYLIBSSH2_SESSION *self, PyObject *args)
 {
     PRINTFUNCNAME
     LIBSSH2_CHANNEL *channel;
+    unsigned long max_window = 0;
+    unsigned long window_size = 0;
+    unsigned long packet_size = 0;
+    unsigned int window;
+    unsigned int packet;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+    unsigned PY_LONG_LONG rtt;
+
+    if (!PyArg_ParseTuple(args, "|kkk:open_session", &max_window, &window_size, &packet_size)) {
+        return NULL;
+    }
+    if (channel_open_sizes(window_size, packet_size, &window, &packet) < 0) {
+        return NULL;
+    }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
-    channel = libssh2_channel_open_session(self->session);
+    channel = libssh2_channel_open_ex(self->session, "session", sizeof("session") - 1,
+                                      window, packet, NULL, 0);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    rtt = channel_open_rtt(self->session, start, end);
+    stats_record(NULL, self->session, PYLIBSSH2_OP_OPEN_SESSION, NULL, start, end,
+                 channel == NULL ? libssh2_session_last_errno(self->session) : 0, 0, 0);
     if(channel == NULL) {
         char *errmsg;
         int rc = libssh2_session_last_error(self->session, &errmsg, NULL, 0);
@@ -758,6 +913,9 @@ PYLIBSSH2_Session_open_session(PYLIBSSH2_SESSION *self, PyObject *args)
             case LIBSSH2_ERROR_CHANNEL_FAILURE:
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_FAILURE: %s", errmsg);
                 return NULL;
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Failed to open a channel session %i: %s", rc, errmsg);
                 return NULL;
@@ -765,169 +923,1340 @@ PYLIBSSH2_Session_open_session(PYLIBSSH2_SESSION *self, PyObject *args)
 
 
     }
-    PyObject *chan = (PyObject *)PYLIBSSH2_Channel_New(self->session, channel);
-    if(chan) {
-        PySet_Add(self->channels, chan);
+    PyObject *chan = (PyObject *)PYLIBSSH2_Channel_New(self->session, channel);
+    if(chan) {
+        channel_window_init(&((PYLIBSSH2_CHANNEL *)chan)->window, channel, max_window, rtt);
+        PySet_Add(self->channels, chan);
+    }
+    return chan;
+}
+/* }}} */
+
+
+/* {{{ PYLIBSSH2_Session_scp_recv
+ */
+static char PYLIBSSH2_Session_scp_recv_doc[] = "\n\
+scp_recv(remote_path, [max_window, window_size]) -> libssh2.Channel\n\
+\n\
+Requests a remote file via SCP protocol.\n\
+\n\
+@param  remote_path: absolute path of remote file to transfer\n\
+@type   remote_path: str\n\
+@param  max_window: when not 0, the receive window grows with the\n\
+                    measured throughput up to max_window bytes\n\
+@type   max_window: int\n\
+@param  window_size: receive window granted once the channel is open,\n\
+                     0 for the libssh2 default\n\
+@type   window_size: int\n\
+\n\
+@return new channel opened\n\
+@rtype  libssh2.Channel";
+
+static PyObject *
+PYLIBSSH2_Session_scp_recv(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    char *path;
+    LIBSSH2_CHANNEL *channel;
+    struct stat fileinfo;
+    unsigned long max_window = 0;
+    unsigned long window_size = 0;
+    if (!PyArg_ParseTuple(args, "s|kk:scp_recv", &path, &max_window, &window_size)) {
+        return NULL;
+    }
+    if (window_size > PYLIBSSH2_WINDOW_LIMIT) {
+        PyErr_Format(PyExc_ValueError, "window_size must be at most %lu", PYLIBSSH2_WINDOW_LIMIT);
+        return NULL;
+    }
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+    unsigned PY_LONG_LONG rtt;
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    channel = libssh2_scp_recv(self->session, path, &fileinfo);
+    if (channel != NULL) {
+        scp_window_open(channel, window_size);
+    }
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    rtt = channel_open_rtt(self->session, start, end);
+    stats_record(NULL, self->session, PYLIBSSH2_OP_OPEN_SESSION, path, start, end,
+                 channel == NULL ? libssh2_session_last_errno(self->session) : 0, 0, 0);
+    if (channel == NULL) {
+        if (libssh2_session_last_errno(self->session) == LIBSSH2_ERROR_EAGAIN) {
+            set_would_block(self->session, NULL);
+            return NULL;
+        }
+        /* CLEAN: PYLIBSSH2_CHANNEL_SCP_RECV_ERROR_MSG */
+        PyErr_SetString(PYLIBSSH2_Error, "SCP receive error.");
+        return NULL;
+    }
+
+    PyObject *chan = (PyObject *)PYLIBSSH2_Channel_New(self->session, channel);
+    if(chan) {
+        channel_window_init(&((PYLIBSSH2_CHANNEL *)chan)->window, channel, max_window, rtt);
+        PySet_Add(self->channels, chan);
+    }
+    return Py_BuildValue("ON", chan, PYLIBSSH2_SftpAttributes_FromStat(&fileinfo));
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_scp_recv_fd
+ */
+static char PYLIBSSH2_Session_scp_recv_fd_doc[] = "\n\
+scp_recv_fd(remote_path, fd, [chunk, preallocate, max_window, window_size]) -> SftpAttributes\n\
+\n\
+Requests a remote file via SCP protocol and writes it to the local file\n\
+descriptor fd from its current position. The channel is drained chunk\n\
+bytes at a time with pwrite, without the GIL. On return fd is positioned\n\
+just after the last byte written.\n\
+\n\
+@param  remote_path: absolute path of remote file to transfer\n\
+@type   remote_path: str\n\
+@param  fd: seekable local file descriptor to write to\n\
+@type   fd: int\n\
+@param  chunk: size of each channel read\n\
+@type   chunk: int\n\
+@param  preallocate: reserve the file size up front with posix_fallocate,\n\
+                     on error the file loses only the tail this added\n\
+@type   preallocate: bool\n\
+@param  max_window: when not 0, the receive window grows with the\n\
+                    measured throughput up to max_window bytes\n\
+@type   max_window: int\n\
+@param  window_size: receive window granted once the channel is open,\n\
+                     0 for the libssh2 default\n\
+@type   window_size: int\n\
+\n\
+@return stat of the remote file\n\
+@rtype  SftpAttributes";
+
+static PyObject *
+PYLIBSSH2_Session_scp_recv_fd(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    char *path;
+    int fd;
+    int chunk = PYLIBSSH2_SCP_CHUNK_SIZE;
+    int preallocate = 1;
+    int rc = 0;
+    int write_errno = 0;
+    off_t base;
+    off_t old_size = 0;
+    off_t filesize = 0;
+    off_t got = 0;
+    ssize_t len;
+    ssize_t written;
+    ssize_t wrc;
+    char *cbuf;
+    LIBSSH2_CHANNEL *channel;
+#if LIBSSH2_VERSION_NUM >= 0x010700
+    libssh2_struct_stat fileinfo;
+#else
+    struct stat fileinfo;
+#endif
+    struct stat fdinfo;
+    unsigned long max_window = 0;
+    unsigned long window_size = 0;
+    PYLIBSSH2_WINDOW window;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if (!PyArg_ParseTuple(args, "si|iikk:scp_recv_fd", &path, &fd, &chunk, &preallocate,
+                          &max_window, &window_size)) {
+        return NULL;
+    }
+
+    if (window_size > PYLIBSSH2_WINDOW_LIMIT) {
+        PyErr_Format(PyExc_ValueError, "window_size must be at most %lu", PYLIBSSH2_WINDOW_LIMIT);
+        return NULL;
+    }
+
+    if (chunk <= 0) {
+        PyErr_SetString(PyExc_ValueError, "chunk must be positive");
+        return NULL;
+    }
+
+    base = lseek(fd, 0, SEEK_CUR);
+    if (base == (off_t)-1) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    cbuf = PyMem_Malloc(chunk);
+    if (cbuf == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+#if LIBSSH2_VERSION_NUM >= 0x010700
+    channel = libssh2_scp_recv2(self->session, path, &fileinfo);
+#else
+    channel = libssh2_scp_recv(self->session, path, &fileinfo);
+#endif
+    if (channel == NULL) {
+        rc = libssh2_session_last_error(self->session, NULL, NULL, 0);
+    }
+    else {
+        scp_window_open(channel, window_size);
+        channel_window_init(&window, channel, max_window, channel_open_rtt(self->session, start, stats_now()));
+        filesize = fileinfo.st_size;
+        preallocate = preallocate && filesize > 0;
+        if (preallocate) {
+            /* the size before, anything past it is ours to give back */
+            preallocate = fstat(fd, &fdinfo) == 0;
+            old_size = fdinfo.st_size;
+        }
+        if (preallocate) {
+            /* only a hint, filesystems without support still get the data */
+            posix_fallocate(fd, base, filesize);
+        }
+
+        while (got < filesize) {
+            len = libssh2_channel_read(channel, cbuf,
+                                       filesize - got < chunk ? filesize - got : chunk);
+            if (len < 0) {
+                rc = len;
+                break;
+            }
+            channel_window_tune(&window, channel, len);
+            if (len == 0) {
+                if (libssh2_channel_eof(channel) == 1) {
+                    rc = LIBSSH2_ERROR_CHANNEL_CLOSED;
+                    break;
+                }
+                continue;
+            }
+            for (written = 0; written < len; written += wrc) {
+                wrc = pwrite(fd, cbuf + written, len - written, base + got + written);
+                if (wrc < 0) {
+                    if (errno == EINTR) {
+                        wrc = 0;
+                        continue;
+                    }
+                    write_errno = errno;
+                    break;
+                }
+            }
+            if (write_errno != 0) {
+                break;
+            }
+            got += len;
+        }
+        libssh2_channel_close(channel);
+        libssh2_channel_free(channel);
+        if (preallocate && got < filesize && old_size < base + filesize) {
+            /* a zero-filled tail would pass for a complete download, only
+               the tail posix_fallocate added goes, data already in the
+               file stays */
+            ftruncate(fd, old_size > base + got ? old_size : base + got);
+        }
+    }
+    lseek(fd, base + got, SEEK_SET);
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(NULL, self->session, PYLIBSSH2_OP_TRANSFER, path, start, end, rc, got, 0);
+
+    PyMem_Free(cbuf);
+
+    if (write_errno != 0) {
+        errno = write_errno;
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    if (rc < 0) {
+        char *errmsg;
+        if(libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            // This is not the error that failed, do not take the string.
+            errmsg = "";
+        }
+        switch(rc) {
+            case LIBSSH2_ERROR_SCP_PROTOCOL :
+                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SCP_PROTOCOL: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_CHANNEL_CLOSED :
+                PyErr_Format(PYLIBSSH2_Error, "The channel has been closed: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN :
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                /* CLEAN: PYLIBSSH2_CHANNEL_SCP_RECV_ERROR_MSG */
+                PyErr_Format(PYLIBSSH2_Error, "SCP receive error %i: %s", rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PYLIBSSH2_SftpAttributes_FromStat((struct stat *)&fileinfo);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_scp_send
+ */
+static char PYLIBSSH2_Session_scp_send_doc[] = "\n\
+scp_send(path, mode, size) -> libssh2.Channel\n\
+\n\
+Sends a file to remote host via SCP protocol.\n\
+\n\
+@param path: absolute path of file to transfer\n\
+@type  path: str\n\
+@param mode: file access mode to create file\n\
+@type  mode: int\n\
+@param size: size of file being transmitted\n\
+@type  size: int\n\
+\n\
+@return new channel opened\n\
+@rtype  libssh2.Channel";
+
+static PyObject *
+PYLIBSSH2_Session_scp_send(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    char *path;
+    int mode;
+    unsigned long filesize;
+    int mtime;
+    int atime;
+    LIBSSH2_CHANNEL *channel;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if (!PyArg_ParseTuple(args, "sikii:scp_send", &path, &mode, &filesize, &mtime, &atime)) {
+        return NULL;
+    }
+
+    start = stats_now();
+#if LIBSSH2_VERSION_NUM >= 0x010206
+    channel = libssh2_scp_send64(self->session, path, mode, filesize, mtime, atime);
+#else
+    channel = libssh2_scp_send_ex(self->session, path, mode, filesize, mtime, atime);
+#endif
+    end = stats_now();
+    stats_record(NULL, self->session, PYLIBSSH2_OP_OPEN_SESSION, path, start, end,
+                 channel == NULL ? libssh2_session_last_errno(self->session) : 0, 0, 0);
+
+    if (channel == NULL) {
+        char *errmsg;
+        int rc = libssh2_session_last_error(self->session, &errmsg, NULL, 0);
+        switch(rc) {
+            case LIBSSH2_ERROR_ALLOC :
+                PyErr_Format(PYLIBSSH2_Error, "An internal memory allocation call failed: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SOCKET_SEND :
+                PyErr_Format(PYLIBSSH2_Error, "Unable to send data on socket: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SCP_PROTOCOL :
+                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SCP_PROTOCOL: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN :
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
+                return NULL;
+        }
+    }
+    PyObject * chan = (PyObject *)PYLIBSSH2_Channel_New(self->session, channel);
+    if(chan) {
+        PySet_Add(self->channels, chan);
+    }
+    return chan;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_scp_send_fd
+ */
+static char PYLIBSSH2_Session_scp_send_fd_doc[] = "\n\
+scp_send_fd(fd, remote_path, mode, size, [mtime, atime, chunk]) -> long\n\
+\n\
+Sends size bytes of the local file descriptor fd, from its current\n\
+position, to remote_path via SCP protocol. The channel is opened, fed and\n\
+closed without the GIL, reading chunk bytes at a time with pread. On\n\
+return fd is positioned just after the last byte sent.\n\
+\n\
+@param  fd: seekable local file descriptor to read from\n\
+@type   fd: int\n\
+@param  remote_path: absolute path of remote file to create\n\
+@type   remote_path: str\n\
+@param  mode: file access mode to create file\n\
+@type   mode: int\n\
+@param  size: number of bytes to transfer\n\
+@type   size: long\n\
+@param  mtime: modification time of the remote file\n\
+@type   mtime: int\n\
+@param  atime: access time of the remote file\n\
+@type   atime: int\n\
+@param  chunk: size of each pread and channel write\n\
+@type   chunk: int\n\
+\n\
+@return number of bytes sent\n\
+@rtype  long";
+
+static PyObject *
+PYLIBSSH2_Session_scp_send_fd(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    int fd;
+    char *path;
+    int mode;
+    PY_LONG_LONG filesize;
+    long mtime = 0;
+    long atime = 0;
+    int chunk = PYLIBSSH2_SCP_CHUNK_SIZE;
+    int rc = 0;
+    int read_errno = 0;
+    off_t base;
+    libssh2_int64_t sent = 0;
+    ssize_t len = 0;
+    ssize_t written;
+    ssize_t wrc;
+    char *cbuf;
+    LIBSSH2_CHANNEL *channel;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if (!PyArg_ParseTuple(args, "isiL|lli:scp_send_fd", &fd, &path, &mode,
+                          &filesize, &mtime, &atime, &chunk)) {
+        return NULL;
+    }
+
+    if (filesize < 0 || chunk <= 0) {
+        PyErr_SetString(PyExc_ValueError, "size must be non-negative and chunk positive");
+        return NULL;
+    }
+
+    base = lseek(fd, 0, SEEK_CUR);
+    if (base == (off_t)-1) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    cbuf = PyMem_Malloc(chunk);
+    if (cbuf == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+#if LIBSSH2_VERSION_NUM >= 0x010206
+    channel = libssh2_scp_send64(self->session, path, mode, filesize, mtime, atime);
+#else
+    channel = libssh2_scp_send_ex(self->session, path, mode, filesize, mtime, atime);
+#endif
+    if (channel == NULL) {
+        rc = libssh2_session_last_error(self->session, NULL, NULL, 0);
+    }
+    else {
+        while (sent < filesize) {
+            len = pread(fd, cbuf, filesize - sent < chunk ? filesize - sent : chunk,
+                        base + sent);
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            if (len <= 0) {
+                /* a file shorter than announced would hang the remote scp */
+                read_errno = len < 0 ? errno : EIO;
+                break;
+            }
+            for (written = 0; written < len; written += wrc) {
+                wrc = libssh2_channel_write(channel, cbuf + written, len - written);
+                if (wrc < 0) {
+                    rc = wrc;
+                    break;
+                }
+            }
+            if (rc < 0) {
+                break;
+            }
+            sent += len;
+        }
+
+        if (rc == 0 && read_errno == 0) {
+            rc = libssh2_channel_send_eof(channel);
+            if (rc == 0) {
+                rc = libssh2_channel_wait_eof(channel);
+            }
+            if (rc == 0) {
+                rc = libssh2_channel_wait_closed(channel);
+            }
+        }
+        libssh2_channel_free(channel);
+    }
+    lseek(fd, base + sent, SEEK_SET);
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(NULL, self->session, PYLIBSSH2_OP_TRANSFER, path, start, end, rc, 0, sent);
+
+    PyMem_Free(cbuf);
+
+    if (read_errno != 0) {
+        errno = read_errno;
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    if (rc < 0) {
+        char *errmsg;
+        if(libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            // This is not the error that failed, do not take the string.
+            errmsg = "";
+        }
+        switch(rc) {
+            case LIBSSH2_ERROR_ALLOC :
+                PyErr_Format(PYLIBSSH2_Error, "An internal memory allocation call failed: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SOCKET_SEND :
+                PyErr_Format(PYLIBSSH2_Error, "Unable to send data on socket: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SCP_PROTOCOL :
+                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SCP_PROTOCOL: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_CHANNEL_CLOSED :
+                PyErr_Format(PYLIBSSH2_Error, "The channel has been closed: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN :
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PyLong_FromLongLong(sent);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_channel_close
+ */
+static char PYLIBSSH2_Session_channel_close_doc[] = "";
+
+static PyObject *
+PYLIBSSH2_Session_channel_close(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    PYLIBSSH2_CHANNEL *channel;
+    int index;
+
+    if (!PyArg_ParseTuple(args, "O:channel_close", &channel)) {
+        return NULL;
+    }
+
+    PySet_Discard(self->channels, (PyObject*)channel);
+    Channel_close(channel);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_set_blocking
+ */
+static char PYLIBSSH2_Session_set_blocking_doc[] = "\n\
+set_blocking([block])\n\
+\n\
+Sets the blocking mode of the session. In non-blocking mode, calls that\n\
+would block raise WouldBlock instead.\n\
+\n\
+@param  block: 1 for blocking (default), 0 for non-blocking\n\
+@type   block: int";
+
+static PyObject *
+PYLIBSSH2_Session_set_blocking(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    /* 1 blocking, 0 non blocking */
+    int block = 1;
+
+    if (!PyArg_ParseTuple(args, "|i:setblocking", &block)) {
+        return NULL;
+    }
+
+    libssh2_session_set_blocking(self->session, block);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_block_directions
+ */
+static char PYLIBSSH2_Session_block_directions_doc[] = "\n\
+block_directions() -> int\n\
+\n\
+Returns the directions the socket must be ready for before the last\n\
+non-blocking call that raised WouldBlock can make progress.\n\
+\n\
+@return combination of SESSION_BLOCK_INBOUND and SESSION_BLOCK_OUTBOUND\n\
+@rtype  int";
+
+static PyObject *
+PYLIBSSH2_Session_block_directions(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    return PyInt_FromLong(libssh2_session_block_directions(self->session));
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_poll
+ */
+static char PYLIBSSH2_Session_poll_doc[] = "\n\
+poll(channels, [timeout, events]) -> list\n\
+\n\
+Waits until at least one of the channels of this session is ready, with\n\
+a single poll of the session socket per round. Readiness is read from the\n\
+channel queues and windows, so no Python call is needed per channel.\n\
+\n\
+@param  channels: channels opened on this session\n\
+@type   channels: sequence of libssh2.Channel\n\
+@param  timeout: maximum time to wait in milliseconds, -1 waits for the\n\
+                 next session activity\n\
+@type   timeout: int\n\
+@param  events: POLLFD_POLLIN, POLLFD_POLLEXT and POLLFD_POLLOUT to watch\n\
+@type   events: int\n\
+\n\
+@return ready events of each channel, in the order of channels, an\n\
+        empty list at once when channels is empty\n\
+@rtype  list of int";
+
+static PyObject *
+PYLIBSSH2_Session_poll(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    PyObject *channels;
+    PyObject *seq;
+    PyObject *revents;
+    PYLIBSSH2_CHANNEL *channel;
+    LIBSSH2_POLLFD *fds;
+    Py_ssize_t nfds;
+    Py_ssize_t i;
+    long timeout = -1;
+    int events = LIBSSH2_POLLFD_POLLIN | LIBSSH2_POLLFD_POLLEXT;
+    int rc;
+
+    if (!PyArg_ParseTuple(args, "O|li:poll", &channels, &timeout, &events)) {
+        return NULL;
+    }
+
+    seq = PySequence_Fast(channels, "channels must be a sequence");
+    if (seq == NULL) {
+        return NULL;
+    }
+
+    nfds = PySequence_Fast_GET_SIZE(seq);
+    if (nfds == 0) {
+        /* libssh2_poll would wait for nothing until the timeout */
+        Py_DECREF(seq);
+        return PyList_New(0);
+    }
+    fds = PyMem_New(LIBSSH2_POLLFD, nfds);
+    if (fds == NULL) {
+        Py_DECREF(seq);
+        return PyErr_NoMemory();
+    }
+
+    for (i = 0; i < nfds; i++) {
+        channel = (PYLIBSSH2_CHANNEL *)PySequence_Fast_GET_ITEM(seq, i);
+        if (!PYLIBSSH2_Channel_Check(channel)) {
+            PyErr_SetString(PyExc_TypeError, "channels must only contain Channel objects");
+            goto error;
+        }
+        if (channel->channel == NULL) {
+            PyErr_Format(PYLIBSSH2_Error, "Channel object has been closed/shutdown.");
+            goto error;
+        }
+        if (channel->session != self->session) {
+            PyErr_SetString(PyExc_ValueError, "channel belongs to another session");
+            goto error;
+        }
+        fds[i].type = LIBSSH2_POLLFD_CHANNEL;
+        fds[i].fd.channel = channel->channel;
+        fds[i].events = events;
+        fds[i].revents = 0;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    rc = libssh2_poll(fds, nfds, timeout);
+    Py_END_ALLOW_THREADS
+
+    if (rc < 0) {
+        char *errmsg;
+        rc = libssh2_session_last_error(self->session, &errmsg, NULL, 0);
+        switch(rc) {
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                break;
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to poll the channels %i: %s", rc, errmsg);
+                break;
+        }
+        goto error;
+    }
+
+    revents = PyList_New(nfds);
+    if (revents == NULL) {
+        goto error;
+    }
+    for (i = 0; i < nfds; i++) {
+        PyList_SET_ITEM(revents, i, PyInt_FromLong(fds[i].revents));
+    }
+
+    PyMem_Free(fds);
+    Py_DECREF(seq);
+    return revents;
+
+error:
+    PyMem_Free(fds);
+    Py_DECREF(seq);
+    return NULL;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_run
+ */
+enum {
+    RUN_OPENING,
+    RUN_EXECUTING,
+    RUN_RUNNING,
+    RUN_CLOSING,
+    RUN_WAITING_CLOSED,
+    RUN_FREEING,
+    RUN_DONE
+};
+
+/* bytes asked to libssh2 per read */
+#define RUN_READ_SIZE   (32 * 1024)
+
+/* output of a command, grown without the GIL */
+typedef struct {
+    char   *data;
+    size_t  used;
+    size_t  size;
+} RUN_BUFFER;
+
+/* one command driven in non-blocking mode, without the GIL */
+typedef struct {
+    const char      *command;
+    int              command_len;
+    const char      *input;
+    size_t           input_len;
+    size_t           input_sent;
+    int              eof_sent;
+    LIBSSH2_CHANNEL *channel;
+    int              state;
+    /* first libssh2 error, 0 if none */
+    int              rc;
+    int              exit_status;
+    char            *exit_signal;
+    size_t           exit_signal_len;
+    RUN_BUFFER       out;
+    RUN_BUFFER       err;
+    unsigned PY_LONG_LONG bytes_written;
+    /* stats_now() when the command was given a channel and when it ended */
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+    unsigned PY_LONG_LONG deadline;
+} RUN_COMMAND;
+
+/*
+ * Reads everything libssh2 has queued for stream_id. Returns 0 on end of
+ * file, LIBSSH2_ERROR_EAGAIN when the queue is empty, or an error.
+ */
+static int
+run_drain(RUN_COMMAND *run, int stream_id, RUN_BUFFER *buffer)
+{
+    int rc;
+
+    while (1) {
+        if (buffer->size - buffer->used < RUN_READ_SIZE) {
+            size_t size = buffer->size ? buffer->size * 2 : 2 * RUN_READ_SIZE;
+            char *data = realloc(buffer->data, size);
+            if (data == NULL) {
+                return LIBSSH2_ERROR_ALLOC;
+            }
+            buffer->data = data;
+            buffer->size = size;
+        }
+
+        rc = libssh2_channel_read_ex(run->channel, stream_id, buffer->data + buffer->used,
+                                     RUN_READ_SIZE);
+        if (rc <= 0) {
+            return rc;
+        }
+        buffer->used += rc;
+    }
+}
+
+/*
+ * Moves run forward as far as it can go without blocking. Returns 1 if
+ * something happened, 0 if it waits for the socket.
+ */
+static int
+run_step(LIBSSH2_SESSION *session, RUN_COMMAND *run)
+{
+    int progress = 0;
+    int rc, eof;
+    size_t out_used, err_used;
+    unsigned long window;
+
+    if (run->state == RUN_OPENING) {
+        run->channel = libssh2_channel_open_session(session);
+        if (run->channel == NULL) {
+            rc = libssh2_session_last_errno(session);
+            if (rc == LIBSSH2_ERROR_EAGAIN) {
+                return 0;
+            }
+            run->rc = rc ? rc : LIBSSH2_ERROR_CHANNEL_FAILURE;
+            run->state = RUN_DONE;
+            return 1;
+        }
+        run->state = RUN_EXECUTING;
+        progress = 1;
+    }
+
+    if (run->state == RUN_EXECUTING) {
+        rc = libssh2_channel_process_startup(run->channel, "exec", sizeof("exec") - 1,
+                                             run->command, run->command_len);
+        if (rc == LIBSSH2_ERROR_EAGAIN) {
+            return progress;
+        }
+        if (rc < 0) {
+            run->rc = rc;
+            run->state = RUN_FREEING;
+            return 1;
+        }
+        run->state = RUN_RUNNING;
+        progress = 1;
+    }
+
+    if (run->state == RUN_RUNNING) {
+        /* stdin is fed while reading, or a command filling its window would never read it */
+        while (!run->eof_sent && run->input_sent < run->input_len) {
+            rc = libssh2_channel_write(run->channel, run->input + run->input_sent,
+                                       run->input_len - run->input_sent);
+            if (rc == LIBSSH2_ERROR_EAGAIN) {
+                break;
+            }
+            if (rc < 0) {
+                if (!libssh2_channel_eof(run->channel)) {
+                    run->rc = rc;
+                    run->state = RUN_FREEING;
+                    return 1;
+                }
+                /* the command exited without reading all its input */
+                run->input_sent = run->input_len;
+                break;
+            }
+            run->input_sent += rc;
+            run->bytes_written += rc;
+            progress = 1;
+        }
+        if (!run->eof_sent && run->input_sent == run->input_len) {
+            rc = libssh2_channel_send_eof(run->channel);
+            if (rc != LIBSSH2_ERROR_EAGAIN) {
+                /* a command already gone may refuse it, its output still counts */
+                run->eof_sent = 1;
+                progress = 1;
+            }
+        }
+
+        /* once eof is seen everything sent before it is queued */
+        eof = libssh2_channel_eof(run->channel);
+        window = libssh2_channel_window_write(run->channel);
+        out_used = run->out.used;
+        err_used = run->err.used;
+        rc = run_drain(run, 0, &run->out);
+        if (rc == 0 || rc == LIBSSH2_ERROR_EAGAIN) {
+            rc = run_drain(run, SSH_EXTENDED_DATA_STDERR, &run->err);
+        }
+        if (rc < 0 && rc != LIBSSH2_ERROR_EAGAIN) {
+            run->rc = rc;
+            run->state = RUN_FREEING;
+            return 1;
+        }
+        /*
+         * the packets read for one stream may bring data for the other,
+         * the eof or window space: nothing of it would wake up a poll
+         */
+        if (run->out.used != out_used || run->err.used != err_used ||
+            libssh2_poll_channel_read(run->channel, 0) ||
+            libssh2_channel_eof(run->channel) != eof ||
+            libssh2_channel_window_write(run->channel) > window) {
+            progress = 1;
+        }
+        if (!eof) {
+            return progress;
+        }
+        run->state = RUN_CLOSING;
+        progress = 1;
+    }
+
+    if (run->state == RUN_CLOSING) {
+        rc = libssh2_channel_close(run->channel);
+        if (rc == LIBSSH2_ERROR_EAGAIN) {
+            return progress;
+        }
+        if (rc < 0) {
+            run->rc = rc;
+            run->state = RUN_FREEING;
+            return 1;
+        }
+        run->state = RUN_WAITING_CLOSED;
+        progress = 1;
+    }
+
+    if (run->state == RUN_WAITING_CLOSED) {
+        rc = libssh2_channel_wait_closed(run->channel);
+        if (rc == LIBSSH2_ERROR_EAGAIN) {
+            return progress;
+        }
+        if (rc < 0) {
+            run->rc = rc;
+            run->state = RUN_FREEING;
+            return 1;
+        }
+        run->exit_status = libssh2_channel_get_exit_status(run->channel);
+        libssh2_channel_get_exit_signal(run->channel, &run->exit_signal, &run->exit_signal_len,
+                                        NULL, NULL, NULL, NULL);
+        run->state = RUN_FREEING;
+        progress = 1;
+    }
+
+    if (run->state == RUN_FREEING) {
+        rc = libssh2_channel_free(run->channel);
+        if (rc == LIBSSH2_ERROR_EAGAIN) {
+            return progress;
+        }
+        run->channel = NULL;
+        run->state = RUN_DONE;
+        progress = 1;
+    }
+
+    return progress;
+}
+
+/* frees the output of run, a channel still open is left to run_drive */
+static void
+run_clear(LIBSSH2_SESSION *session, RUN_COMMAND *run)
+{
+    free(run->out.data);
+    free(run->err.data);
+    if (run->exit_signal != NULL) {
+        libssh2_free(session, run->exit_signal);
+    }
+    memset(&run->out, 0, sizeof(run->out));
+    memset(&run->err, 0, sizeof(run->err));
+    run->exit_signal = NULL;
+}
+
+/*
+ * Gives up on run. Its channel is freed at once when that does not block,
+ * else by run_drive once the session is back in blocking mode. Closing the
+ * channel does not signal the remote process.
+ */
+static void
+run_expire(RUN_COMMAND *run)
+{
+    run->rc = LIBSSH2_ERROR_SOCKET_TIMEOUT;
+    if (run->channel != NULL && libssh2_channel_free(run->channel) != LIBSSH2_ERROR_EAGAIN) {
+        run->channel = NULL;
+    }
+    run->state = RUN_DONE;
+}
+
+/*
+ * (exit_status, stdout, stderr, signal) of a finished run, or the
+ * exception that failed it.
+ */
+static PyObject *
+run_item(LIBSSH2_SESSION *session, RUN_COMMAND *run)
+{
+    PyObject *type, *value, *traceback;
+    char *errmsg;
+
+    if (run->rc == 0) {
+        return Py_BuildValue("(is#s#z#)", run->exit_status,
+                             run->out.data ? run->out.data : "", (int)run->out.used,
+                             run->err.data ? run->err.data : "", (int)run->err.used,
+                             run->exit_signal, (int)run->exit_signal_len);
+    }
+
+    if (libssh2_session_last_error(session, &errmsg, NULL, 0) != run->rc) {
+        // This is not the error that failed, do not take the string.
+        errmsg = "";
+    }
+    switch(run->rc) {
+        case LIBSSH2_ERROR_SOCKET_TIMEOUT:
+            PyErr_Format(PYLIBSSH2_Error, "Timed out running command.");
+            break;
+
+        case LIBSSH2_ERROR_ALLOC:
+            PyErr_Format(PYLIBSSH2_Error, "An internal memory allocation call failed: %s", errmsg);
+            break;
+
+        case LIBSSH2_ERROR_CHANNEL_FAILURE:
+            PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_FAILURE: %s", errmsg);
+            break;
+
+        case LIBSSH2_ERROR_CHANNEL_REQUEST_DENIED:
+            PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_REQUEST_DENIED: %s", errmsg);
+            break;
+
+        case LIBSSH2_ERROR_CHANNEL_CLOSED:
+            PyErr_Format(PYLIBSSH2_Error, "The channel has been closed: %s", errmsg);
+            break;
+
+        default:
+            PyErr_Format(PYLIBSSH2_Error, "Unable to run command %i: %s", run->rc, errmsg);
+            break;
+    }
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+
+    return value;
+}
+
+/*
+ * Runs the n commands of runs with at most max_channels channels open at
+ * once, stepping them all between two polls of the session socket. The
+ * loop runs in non-blocking mode with the GIL released; it is only taken
+ * back when commands end, with the session in its own blocking mode, to
+ * account them, store their item in results and call callback(index,
+ * item) when it is not NULL. A server refusing one
+ * more channel lowers max_channels to the channels it accepted. Returns
+ * -1 with an exception set if callback raised or memory ran out.
+ */
+static int
+run_drive(PYLIBSSH2_SESSION *self, RUN_COMMAND *runs, int n, int max_channels,
+          int timeout, PyObject *callback, PyObject *results)
+{
+    RUN_COMMAND *run;
+    PyObject *item, *ret;
+    int *active, *retry, *ended;
+    int nactive = 0, nretry = 0, nended, next = 0, done = 0, failed = 0;
+    int fd, blocking, wait, progress, index, i;
+    unsigned PY_LONG_LONG now;
+
+    fd = PYLIBSSH2_Session_fileno(self->session);
+    if (fd < 0) {
+        PyErr_SetString(PYLIBSSH2_Error, "Unable to find the socket of the session.");
+        return -1;
+    }
+
+    if (max_channels > n) {
+        max_channels = n;
+    }
+    active = malloc(max_channels * sizeof(int));
+    ended = malloc(max_channels * sizeof(int));
+    retry = malloc(max_channels * sizeof(int));
+    if (active == NULL || ended == NULL || retry == NULL) {
+        free(active);
+        free(ended);
+        free(retry);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    blocking = libssh2_session_get_blocking(self->session);
+    libssh2_session_set_blocking(self->session, 0);
+
+    while (done < n) {
+        now = stats_now();
+        while (nactive < max_channels && (nretry > 0 || next < n)) {
+            index = nretry > 0 ? retry[--nretry] : next++;
+            runs[index].start = now;
+            runs[index].deadline = now + (unsigned PY_LONG_LONG)timeout * 1000000ULL;
+            active[nactive++] = index;
+        }
+
+        progress = 0;
+        nended = 0;
+        for (i = 0; i < nactive; ) {
+            run = &runs[active[i]];
+            progress |= run_step(self->session, run);
+            if (run->state != RUN_DONE && timeout >= 0 && stats_now() >= run->deadline) {
+                /* a command printing without pause must time out too */
+                run_expire(run);
+            }
+            if (run->state != RUN_DONE) {
+                i++;
+                continue;
+            }
+            run->end = stats_now();
+            /* only the channel open fails with this error */
+            if (run->rc == LIBSSH2_ERROR_CHANNEL_FAILURE && nactive > 1) {
+                max_channels = nactive - 1;
+                run->rc = 0;
+                run->state = RUN_OPENING;
+                retry[nretry++] = active[i];
+            } else {
+                ended[nended++] = active[i];
+            }
+            active[i] = active[--nactive];
+            progress = 1;
+        }
+
+        if (nended > 0) {
+            Py_BLOCK_THREADS
+            /* the trace and the callback may use the session */
+            libssh2_session_set_blocking(self->session, blocking);
+            for (i = 0; i < nended; i++) {
+                run = &runs[ended[i]];
+                stats_record(NULL, self->session, PYLIBSSH2_OP_EXEC, NULL, run->start, run->end, run->rc,
+                             run->out.used + run->err.used, run->bytes_written);
+                item = run_item(self->session, run);
+                run_clear(self->session, run);
+                if (item == NULL) {
+                    failed = 1;
+                    break;
+                }
+                PyList_SET_ITEM(results, ended[i], item);
+                done++;
+                if (callback != NULL) {
+                    ret = PyObject_CallFunction(callback, "iO", ended[i], item);
+                    if (ret == NULL) {
+                        failed = 1;
+                        break;
+                    }
+                    Py_DECREF(ret);
+                }
+            }
+            libssh2_session_set_blocking(self->session, 0);
+            Py_UNBLOCK_THREADS
+            if (failed) {
+                break;
+            }
+        }
+
+        if (done == n || progress) {
+            continue;
+        }
+
+        if (timeout >= 0) {
+            now = stats_now();
+            wait = -1;
+            for (i = 0; i < nactive; i++) {
+                run = &runs[active[i]];
+                if (run->deadline <= now) {
+                    wait = 0;
+                } else if (wait < 0 || run->deadline - now < (unsigned PY_LONG_LONG)wait * 1000000ULL) {
+                    wait = (int)((run->deadline - now + 999999) / 1000000);
+                }
+            }
+            wait_socket(fd, self->session, wait);
+        } else {
+            wait = libssh2_session_get_timeout(self->session);
+            if (wait_socket(fd, self->session, wait ? wait : -1) == 0) {
+                for (i = 0; i < nactive; i++) {
+                    run_expire(&runs[active[i]]);
+                }
+            }
+        }
+    }
+
+    /* the commands still running after a failed callback */
+    for (i = 0; i < nactive; i++) {
+        run_expire(&runs[active[i]]);
+    }
+    /* the expired channels whose free would have blocked */
+    libssh2_session_set_blocking(self->session, 1);
+    for (i = 0; i < n; i++) {
+        if (runs[i].channel != NULL) {
+            libssh2_channel_free(runs[i].channel);
+            runs[i].channel = NULL;
+        }
     }
-    return chan;
-}
-/* }}} */
+    libssh2_session_set_blocking(self->session, blocking);
+    Py_END_ALLOW_THREADS
 
+    for (i = 0; i < n; i++) {
+        run_clear(self->session, &runs[i]);
+    }
+    free(active);
+    free(ended);
+    free(retry);
 
-/* {{{ PYLIBSSH2_Session_scp_recv
- */
-static char PYLIBSSH2_Session_scp_recv_doc[] = "\n\
-scp_recv(remote_path) -> libssh2.Channel\n\
+    return failed ? -1 : 0;
+}
+
+static char PYLIBSSH2_Session_run_doc[] = "\n\
+run(command, [stdin, timeout]) -> (int, str, str, str)\n\
 \n\
-Requests a remote file via SCP protocol.\n\
+Runs command on a new channel and waits for its end. The channel is\n\
+driven in non-blocking mode with the GIL released, stdin is written while\n\
+stdout and stderr are read, so neither side can stall the other. The\n\
+session is back in its blocking mode on return.\n\
 \n\
-@param  remote_path: absolute path of remote file to transfer\n\
-@type   remote_path: str\n\
+@param  command: command line given to the remote shell\n\
+@type   command: str\n\
+@param  stdin: data written to the command before end of file\n\
+@type   stdin: str or None\n\
+@param  timeout: maximum duration in milliseconds, -1 uses the session\n\
+                 timeout between two socket events. A command timing\n\
+                 out has its channel closed but the remote process is\n\
+                 not signalled and may keep running.\n\
+@type   timeout: int\n\
 \n\
-@return new channel opened\n\
-@rtype  libssh2.Channel";
+@return exit status, stdout, stderr and the name of the signal that\n\
+        killed the command or None\n\
+@rtype  tuple";
 
 static PyObject *
-PYLIBSSH2_Session_scp_recv(PYLIBSSH2_SESSION *self, PyObject *args)
+PYLIBSSH2_Session_run(PYLIBSSH2_SESSION *self, PyObject *args)
 {
     PRINTFUNCNAME
-    char *path;
-    LIBSSH2_CHANNEL *channel;
-    struct stat fileinfo;
-    if (!PyArg_ParseTuple(args, "s:scp_recv", &path)) {
+    RUN_COMMAND run;
+    PyObject *results;
+    PyObject *item;
+    char *input = NULL;
+    int input_len = 0;
+    int timeout = -1;
+
+    memset(&run, 0, sizeof(run));
+    if (!PyArg_ParseTuple(args, "s#|z#i:run", &run.command, &run.command_len,
+                          &input, &input_len, &timeout)) {
         return NULL;
     }
+    run.input = input;
+    run.input_len = input_len;
 
-    Py_BEGIN_ALLOW_THREADS
-    channel = libssh2_scp_recv(self->session, path, &fileinfo);
-    Py_END_ALLOW_THREADS
-    if (channel == NULL) {
-        /* CLEAN: PYLIBSSH2_CHANNEL_SCP_RECV_ERROR_MSG */
-        PyErr_SetString(PYLIBSSH2_Error, "SCP receive error.");
+    results = PyList_New(1);
+    if (results == NULL) {
+        return NULL;
+    }
+    if (run_drive(self, &run, 1, 1, timeout, NULL, results) < 0) {
+        Py_DECREF(results);
         return NULL;
     }
 
-    PyObject *chan = (PyObject *)PYLIBSSH2_Channel_New(self->session, channel);
-    if(chan) {
-        PySet_Add(self->channels, chan);
+    item = PyList_GET_ITEM(results, 0);
+    if (PyExceptionInstance_Check(item)) {
+        PyErr_SetObject((PyObject *)Py_TYPE(item), item);
+        item = NULL;
+    } else {
+        Py_INCREF(item);
     }
-    return Py_BuildValue("OO", chan, stat_to_statdict(&fileinfo));
+    Py_DECREF(results);
+
+    return item;
 }
 /* }}} */
 
-/* {{{ PYLIBSSH2_Session_scp_send
+/* {{{ PYLIBSSH2_Session_run_many
  */
-static char PYLIBSSH2_Session_scp_send_doc[] = "\n\
-scp_send(path, mode, size) -> libssh2.Channel\n\
+static char PYLIBSSH2_Session_run_many_doc[] = "\n\
+run_many(commands, [max_channels, timeout, callback]) -> list\n\
 \n\
-Sends a file to remote host via SCP protocol.\n\
+Runs commands on up to max_channels channels of this session at once,\n\
+all driven by a single poll loop without the GIL. When the server refuses\n\
+a channel, the commands wait for one of the channels already open.\n\
 \n\
-@param path: absolute path of file to transfer\n\
-@type  path: str\n\
-@param mode: file access mode to create file\n\
-@type  mode: int\n\
-@param size: size of file being transmitted\n\
-@type  size: int\n\
+@param  commands: command lines, or (command, stdin) tuples\n\
+@type   commands: sequence\n\
+@param  max_channels: channels open at once\n\
+@type   max_channels: int\n\
+@param  timeout: maximum duration of each command in milliseconds, -1 uses\n\
+                 the session timeout between two socket events, see run()\n\
+@type   timeout: int\n\
+@param  callback: called with (index, item) as soon as a command ends\n\
+@type   callback: callable\n\
 \n\
-@return new channel opened\n\
-@rtype  libssh2.Channel";
+@return one item per command, the (exit_status, stdout, stderr, signal)\n\
+        tuple of run() or the exception that failed the command\n\
+@rtype  list";
 
 static PyObject *
-PYLIBSSH2_Session_scp_send(PYLIBSSH2_SESSION *self, PyObject *args)
+PYLIBSSH2_Session_run_many(PYLIBSSH2_SESSION *self, PyObject *args)
 {
     PRINTFUNCNAME
-    char *path;
-    int mode;
-    unsigned long filesize;
-    int mtime;
-    int atime;
-    LIBSSH2_CHANNEL *channel;
-
-    if (!PyArg_ParseTuple(args, "sikii:scp_send", &path, &mode, &filesize, &mtime, &atime)) {
+    PyObject *commands;
+    PyObject *callback = NULL;
+    PyObject *seq;
+    PyObject *results = NULL;
+    PyObject *command;
+    RUN_COMMAND *runs = NULL;
+    int max_channels = 8;
+    int timeout = -1;
+    char *input;
+    int input_len;
+    int n, i;
+
+    if (!PyArg_ParseTuple(args, "O|iiO:run_many", &commands, &max_channels,
+                          &timeout, &callback)) {
         return NULL;
     }
-
-#if LIBSSH2_VERSION_NUM >= 0x010206
-    channel = libssh2_scp_send64(self->session, path, mode, filesize, mtime, atime);
-#else
-    channel = libssh2_scp_send_ex(self->session, path, mode, filesize, mtime, atime);
-#endif
-
-    if (channel == NULL) {
-        char *errmsg;
-        int rc = libssh2_session_last_error(self->session, &errmsg, NULL, 0);
-        switch(rc) {
-            case LIBSSH2_ERROR_ALLOC :
-                PyErr_Format(PYLIBSSH2_Error, "An internal memory allocation call failed: %s", errmsg);
-                return NULL;
-
-            case LIBSSH2_ERROR_SOCKET_SEND :
-                PyErr_Format(PYLIBSSH2_Error, "Unable to send data on socket: %s", errmsg);
-                return NULL;
-
-            case LIBSSH2_ERROR_SCP_PROTOCOL :
-                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SCP_PROTOCOL: %s", errmsg);
-                return NULL;
-
-            case LIBSSH2_ERROR_EAGAIN :
-                PyErr_Format(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block: %s", errmsg);
-                return NULL;
-
-            default:
-                PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
-                return NULL;
-        }
+    if (max_channels <= 0) {
+        PyErr_SetString(PyExc_ValueError, "max_channels must be positive");
+        return NULL;
     }
-    PyObject * chan = (PyObject *)PYLIBSSH2_Channel_New(self->session, channel);
-    if(chan) {
-        PySet_Add(self->channels, chan);
+    if (callback == Py_None) {
+        callback = NULL;
     }
-    return chan;
-}
-/* }}} */
-
-/* {{{ PYLIBSSH2_Session_channel_close
- */
-static char PYLIBSSH2_Session_channel_close_doc[] = "";
-
-static PyObject *
-PYLIBSSH2_Session_channel_close(PYLIBSSH2_SESSION *self, PyObject *args)
-{
-    PRINTFUNCNAME
-    PYLIBSSH2_CHANNEL *channel;
-    int index;
-
-    if (!PyArg_ParseTuple(args, "O:channel_close", &channel)) {
+    if (callback != NULL && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
         return NULL;
     }
 
-    PySet_Discard(self->channels, (PyObject*)channel);
-    Channel_close(channel);
-
-    Py_INCREF(Py_None);
-    return Py_None;
-}
-/* }}} */
+    /* a tuple of our own, read without the GIL */
+    seq = PySequence_Tuple(commands);
+    if (seq == NULL) {
+        return NULL;
+    }
+    n = PyTuple_GET_SIZE(seq);
 
-/* {{{ PYLIBSSH2_Session_set_blocking
- */
-static char PYLIBSSH2_Session_set_blocking_doc[] = "";
+    runs = calloc(n ? n : 1, sizeof(RUN_COMMAND));
+    if (runs == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    for (i = 0; i < n; i++) {
+        command = PyTuple_GET_ITEM(seq, i);
+        input = NULL;
+        input_len = 0;
+        if (PyTuple_Check(command)) {
+            if (!PyArg_ParseTuple(command, "s#z#:run_many", &runs[i].command,
+                                  &runs[i].command_len, &input, &input_len)) {
+                goto error;
+            }
+        } else if (PyString_Check(command)) {
+            runs[i].command = PyString_AS_STRING(command);
+            runs[i].command_len = PyString_GET_SIZE(command);
+        } else {
+            PyErr_SetString(PyExc_TypeError, "commands must be strings or (command, stdin) tuples");
+            goto error;
+        }
+        runs[i].input = input;
+        runs[i].input_len = input_len;
+    }
 
-static PyObject *
-PYLIBSSH2_Session_set_blocking(PYLIBSSH2_SESSION *self, PyObject *args)
-{
-    PRINTFUNCNAME
-    /* 1 blocking, 0 non blocking */
-    int block = 1;
+    /* run_drive fills every slot, the list is dropped if it cannot */
+    results = PyList_New(n);
+    if (results == NULL) {
+        goto error;
+    }
 
-    if (!PyArg_ParseTuple(args, "|i:setblocking", &block)) {
-        return NULL;
+    if (n > 0 && run_drive(self, runs, n, max_channels, timeout, callback, results) < 0) {
+        Py_CLEAR(results);
     }
 
-    libssh2_session_set_blocking(self->session, block);
+error:
+    free(runs);
+    Py_DECREF(seq);
 
-    Py_INCREF(Py_None);
-    return Py_None;
+    return results;
 }
 /* }}} */
 
@@ -946,8 +2275,14 @@ PYLIBSSH2_Session_sftp_init(PYLIBSSH2_SESSION *self, PyObject *args)
 {
     PRINTFUNCNAME
     LIBSSH2_SFTP *sftp;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
+    start = stats_now();
     sftp = libssh2_sftp_init(self->session);
+    end = stats_now();
+    stats_record(NULL, self->session, PYLIBSSH2_OP_SFTP_INIT, NULL, start, end,
+                 sftp == NULL ? libssh2_session_last_errno(self->session) : 0, 0, 0);
 
     if (sftp == NULL) {
         char *errmsg;
@@ -966,7 +2301,7 @@ PYLIBSSH2_Session_sftp_init(PYLIBSSH2_SESSION *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "An invalid SFTP protocol response was received on the socket, or an SFTP operation caused an errorcode to be returned by the server: %s", errmsg);
                 return NULL;
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_EAGAIN: %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
             case LIBSSH2_ERROR_CHANNEL_FAILURE:
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_CHANNEL_FAILURE: %s", errmsg);
@@ -1012,7 +2347,7 @@ PYLIBSSH2_Session_sftp_shutdown(PYLIBSSH2_SESSION *self, PyObject *args)
 /* {{{ PYLIBSSH2_Session_direct_tcpip
  */
 static char PYLIBSSH2_Session_direct_tcpip_doc[] = "\n\
-direct_tcpip(host, port, shost, sport) -> libssh2.Channel\n\
+direct_tcpip(host, port, [shost, sport, max_window, window_size, packet_size]) -> libssh2.Channel\n\
 \n\
 Tunnels a TCP connection through an SSH Session.\n\
 \n\
@@ -1024,6 +2359,14 @@ Tunnels a TCP connection through an SSH Session.\n\
 @type   shost: str\n\
 @param  sport: local port\n\
 @type   sport: int\n\
+@param  max_window: when not 0, the receive window grows with the\n\
+                    measured throughput up to max_window bytes\n\
+@type   max_window: int\n\
+@param  window_size: initial receive window, 0 for the libssh2 default\n\
+@type   window_size: int\n\
+@param  packet_size: largest data packet the server may send, at most\n\
+                     32768, 0 for the libssh2 default\n\
+@type   packet_size: int\n\
 \n\
 @return new opened channel\n\
 @rtype  libssh2.Channel";
@@ -1041,14 +2384,53 @@ PYLIBSSH2_Session_direct_tcpip(PYLIBSSH2_SESSION *self, PyObject *args)
     /* remote port */
     int port;
     LIBSSH2_CHANNEL *channel;
-
-    if (!PyArg_ParseTuple(args, "si|si:direct_tcpip", &host, &port, &shost, &sport)) {
+    PyObject *chan;
+    unsigned long max_window = 0;
+    unsigned long window_size = 0;
+    unsigned long packet_size = 0;
+    unsigned int window;
+    unsigned int packet;
+    /* the channel open request data, as libssh2_channel_direct_tcpip_ex builds it */
+    unsigned char *message;
+    unsigned char *s;
+    size_t host_len;
+    size_t shost_len;
+    size_t message_len;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+    unsigned PY_LONG_LONG rtt;
+
+    if (!PyArg_ParseTuple(args, "si|sikkk:direct_tcpip", &host, &port, &shost, &sport,
+                          &max_window, &window_size, &packet_size)) {
+        return NULL;
+    }
+    if (channel_open_sizes(window_size, packet_size, &window, &packet) < 0) {
         return NULL;
     }
 
+    host_len = strlen(host);
+    shost_len = strlen(shost);
+    message_len = host_len + shost_len + 16;
+    message = PyMem_Malloc(message_len);
+    if (message == NULL) {
+        return PyErr_NoMemory();
+    }
+    s = message;
+    s = store_str(s, host, host_len);
+    s = store_u32(s, port);
+    s = store_str(s, shost, shost_len);
+    store_u32(s, sport);
+
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
-    channel = libssh2_channel_direct_tcpip_ex(self->session, host, port, shost, sport);
+    channel = libssh2_channel_open_ex(self->session, "direct-tcpip", sizeof("direct-tcpip") - 1,
+                                      window, packet, (char *)message, message_len);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    PyMem_Free(message);
+    rtt = channel_open_rtt(self->session, start, end);
+    stats_record(NULL, self->session, PYLIBSSH2_OP_OPEN_SESSION, NULL, start, end,
+                 channel == NULL ? libssh2_session_last_errno(self->session) : 0, 0, 0);
 
     if (channel == NULL) {
         char *errmsg;
@@ -1057,13 +2439,21 @@ PYLIBSSH2_Session_direct_tcpip(PYLIBSSH2_SESSION *self, PyObject *args)
             case LIBSSH2_ERROR_ALLOC:
                 PyErr_Format(PYLIBSSH2_Error, "An internal memory allocation call failed: %s", errmsg);
                 return NULL;
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
         }
     }
 
-    return (PyObject *)channel;
+    chan = (PyObject *)PYLIBSSH2_Channel_New(self->session, channel);
+    if(chan) {
+        channel_window_init(&((PYLIBSSH2_CHANNEL *)chan)->window, channel, max_window, rtt);
+        PySet_Add(self->channels, chan);
+    }
+    return chan;
 }
 /* }}} */
 
@@ -1126,7 +2516,7 @@ PYLIBSSH2_Session_forward_listen(PYLIBSSH2_SESSION *self, PyObject *args)
                 return NULL;
 
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block: %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -1165,6 +2555,82 @@ PYLIBSSH2_Session_forward_cancel(PYLIBSSH2_SESSION *self, PyObject *args)
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Session_keepalive_config
+ */
+static char PYLIBSSH2_Session_keepalive_config_doc[] = "\n\
+keepalive_config(want_reply, interval)\n\
+\n\
+Configures the keepalive messages sent by keepalive_send.\n\
+\n\
+@param  want_reply: ask the server to answer keepalive messages\n\
+@type   want_reply: int\n\
+@param  interval: seconds between keepalive messages, 0 disables them\n\
+@type   interval: int";
+
+static PyObject *
+PYLIBSSH2_Session_keepalive_config(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    int want_reply;
+    unsigned int interval;
+
+    if (!PyArg_ParseTuple(args, "iI:keepalive_config", &want_reply, &interval)) {
+        return NULL;
+    }
+
+    libssh2_keepalive_config(self->session, want_reply, interval);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_keepalive_send
+ */
+static char PYLIBSSH2_Session_keepalive_send_doc[] = "\n\
+keepalive_send() -> int\n\
+\n\
+Sends a keepalive message if the configured interval has elapsed.\n\
+\n\
+@return seconds until the next keepalive message is due\n\
+@rtype  int";
+
+static PyObject *
+PYLIBSSH2_Session_keepalive_send(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    int rc;
+    int seconds_to_next = 0;
+
+    Py_BEGIN_ALLOW_THREADS
+    rc = libssh2_keepalive_send(self->session, &seconds_to_next);
+    Py_END_ALLOW_THREADS
+
+    if (rc < 0) {
+        char *errmsg;
+        if(libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            // This is not the error that failed, do not take the string.
+            errmsg = "";
+        }
+        switch(rc) {
+            case LIBSSH2_ERROR_SOCKET_SEND:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to send data on socket: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to send keepalive %i: %s", rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PyInt_FromLong(seconds_to_next);
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Session_last_error
  */
 static char PYLIBSSH2_Session_last_error_doc[] = "\n\
@@ -1377,14 +2843,19 @@ PYLIBSSH2_Session_userauth_keyboardinteractive(PYLIBSSH2_SESSION *self, PyObject
     int rc=0;
     char *username;
     /*PyObject *kbd_callback;*/
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(!PyArg_ParseTuple(args, "ssi:userauth_keyboardinteractive", &username, &interactive_response, &interactive_response_len)) {
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_userauth_keyboard_interactive(self->session, username, &stub_kbd_callback_func);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(NULL, self->session, PYLIBSSH2_OP_AUTH, NULL, start, end, rc, 0, 0);
 
     if (rc < 0) {
         char *errmsg;
@@ -1405,6 +2876,10 @@ PYLIBSSH2_Session_userauth_keyboardinteractive(PYLIBSSH2_SESSION *self, PyObject
                 PyErr_Format(PYLIBSSH2_Error, "failed, invalid username/password or public/private key: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unknown Error %i: %s", rc, errmsg);
                 return NULL;
@@ -1418,6 +2893,127 @@ PYLIBSSH2_Session_userauth_keyboardinteractive(PYLIBSSH2_SESSION *self, PyObject
 
 /* }}} */
 
+/* {{{ stats_breakdown
+ */
+static int
+stats_breakdown(PyObject *list, PyObject *set)
+{
+    PyObject *iter;
+    PyObject *item;
+    PyObject *entry;
+    PYLIBSSH2_STATS *stats;
+
+    iter = PyObject_GetIter(set);
+    if (iter == NULL) {
+        return -1;
+    }
+    while ((item = PyIter_Next(iter)) != NULL) {
+        if (PYLIBSSH2_Channel_Check(item)) {
+            entry = Py_BuildValue("(ON)", item, channel_stats_to_dict((PYLIBSSH2_CHANNEL *)item));
+            Py_DECREF(item);
+            if (entry == NULL || PyList_Append(list, entry) < 0) {
+                Py_XDECREF(entry);
+                Py_DECREF(iter);
+                return -1;
+            }
+            Py_DECREF(entry);
+            continue;
+        }
+        if (PYLIBSSH2_Sftp_Check(item)) {
+            stats = &((PYLIBSSH2_SFTP *)item)->stats;
+        } else if (PYLIBSSH2_Sftpfile_Check(item)) {
+            stats = &((PYLIBSSH2_SFTPFILE *)item)->stats;
+        } else {
+            stats = &((PYLIBSSH2_SFTPDIR *)item)->stats;
+        }
+        entry = Py_BuildValue("(ON)", item, stats_to_dict(stats));
+        Py_DECREF(item);
+        if (entry == NULL || PyList_Append(list, entry) < 0) {
+            Py_XDECREF(entry);
+            Py_DECREF(iter);
+            return -1;
+        }
+        Py_DECREF(entry);
+    }
+    Py_DECREF(iter);
+    return PyErr_Occurred() ? -1 : 0;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Session_stats
+ */
+static char PYLIBSSH2_Session_stats_doc[] = "\n\
+stats() -> dict\n\
+\n\
+Returns a snapshot of the counters of the libssh2 calls made by this\n\
+session. Each counter set holds calls, bytes_read, bytes_written, eagain,\n\
+errors and blocked_ns, the time spent inside libssh2 in nanoseconds.\n\
+\n\
+@return {'session': totals of every call of the session,\n\
+         'channels': [(Channel, counters), ...],\n\
+         'sftps': [(Sftp, counters), ...],\n\
+         'files': [(Sftpfile, counters), ...],\n\
+         'directories': [(Sftpdir, counters), ...]}\n\
+for the objects still open\n\
+@rtype  dict";
+
+static PyObject *
+PYLIBSSH2_Session_stats(PYLIBSSH2_SESSION *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    PyObject *iter;
+    PyObject *item;
+    PyObject *channels = PyList_New(0);
+    PyObject *sftps = PyList_New(0);
+    PyObject *files = PyList_New(0);
+    PyObject *directories = PyList_New(0);
+
+    if (channels == NULL || sftps == NULL || files == NULL || directories == NULL) {
+        goto error;
+    }
+    if (stats_breakdown(channels, self->channels) < 0 ||
+        stats_breakdown(sftps, self->sftps) < 0) {
+        goto error;
+    }
+
+    iter = PyObject_GetIter(self->sftps);
+    if (iter == NULL) {
+        goto error;
+    }
+    while ((item = PyIter_Next(iter)) != NULL) {
+        PYLIBSSH2_SFTP *sftp = (PYLIBSSH2_SFTP *)item;
+        int rc = stats_breakdown(files, sftp->files);
+
+        if (rc == 0) {
+            rc = stats_breakdown(directories, sftp->directories);
+        }
+        Py_DECREF(item);
+        if (rc < 0) {
+            Py_DECREF(iter);
+            goto error;
+        }
+    }
+    Py_DECREF(iter);
+    if (PyErr_Occurred()) {
+        goto error;
+    }
+
+    return Py_BuildValue("{s:N,s:N,s:N,s:N,s:N}",
+                         "session", stats_to_dict(&self->stats),
+                         "channels", channels,
+                         "sftps", sftps,
+                         "files", files,
+                         "directories", directories);
+
+error:
+    Py_XDECREF(channels);
+    Py_XDECREF(sftps);
+    Py_XDECREF(files);
+    Py_XDECREF(directories);
+    return NULL;
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Session_methods[]
  *
  * ADD_METHOD(name) expands to a correct PyMethodDef declaration
@@ -1430,16 +3026,24 @@ PYLIBSSH2_Session_userauth_keyboardinteractive(PYLIBSSH2_SESSION *self, PyObject
 
 static PyMethodDef PYLIBSSH2_Session_methods[] =
 {
+    ADD_METHOD(block_directions),
     ADD_METHOD(callback_set),
     ADD_METHOD(close),
     ADD_METHOD(direct_tcpip),
     ADD_METHOD(forward_listen),
     ADD_METHOD(forward_cancel),
     ADD_METHOD(hostkey_hash),
+    ADD_METHOD(keepalive_config),
+    ADD_METHOD(keepalive_send),
     ADD_METHOD(last_error),
     ADD_METHOD(open_session),
+    ADD_METHOD(poll),
+    ADD_METHOD(run),
+    ADD_METHOD(run_many),
     ADD_METHOD(scp_recv),
+    ADD_METHOD(scp_recv_fd),
     ADD_METHOD(scp_send),
+    ADD_METHOD(scp_send_fd),
     ADD_METHOD(channel_close),
     ADD_METHOD(session_methods),
     ADD_METHOD(session_method_pref),
@@ -1449,6 +3053,7 @@ static PyMethodDef PYLIBSSH2_Session_methods[] =
     ADD_METHOD(sftp_init),
     ADD_METHOD(sftp_shutdown),
     ADD_METHOD(startup),
+    ADD_METHOD(stats),
     ADD_METHOD(userauth_agent),
     ADD_METHOD(userauth_authenticated),
     ADD_METHOD(userauth_hostbased_fromfile),
@@ -1484,6 +3089,9 @@ PYLIBSSH2_Session_New(LIBSSH2_SESSION *session)
     self->sftps = PySet_New(0);
     self->channels = PySet_New(0);
     self->listeners = PySet_New(0);
+    stats_init(&self->stats);
+    /* lets objects holding only the LIBSSH2_SESSION find the socket */
+    *libssh2_session_abstract(session) = self;
 
     libssh2_banner_set(session, LIBSSH2_SSH_DEFAULT_BANNER"_Python");
 
@@ -1491,6 +3099,26 @@ PYLIBSSH2_Session_New(LIBSSH2_SESSION *session)
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Session_fileno
+ */
+int
+PYLIBSSH2_Session_fileno(LIBSSH2_SESSION *session)
+{
+    PYLIBSSH2_SESSION *self = *libssh2_session_abstract(session);
+    int fd;
+
+    if (self == NULL || self->socket == NULL) {
+        return -1;
+    }
+    fd = PyObject_AsFileDescriptor(self->socket);
+    if (fd < 0) {
+        PyErr_Clear();
+    }
+
+    return fd;
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Session_dealloc
  */
 static void
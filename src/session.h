@@ -23,11 +23,15 @@
 
 #include <Python.h>
 #include <libssh2.h>
+#include "stats.h"
 
 extern int init_libssh2_Session(PyObject *);
 
 extern PyTypeObject PYLIBSSH2_Session_Type;
 
+/* default size of the reads and channel writes done by scp_*_fd */
+#define PYLIBSSH2_SCP_CHUNK_SIZE    (128 * 1024)
+
 #define PYLIBSSH2_Session_Check(v) ((v)->ob_type == &PYLIBSSH2_Session_Type)
 
 typedef struct {
@@ -38,6 +42,11 @@ typedef struct {
     PyObject        *sftps;
     PyObject        *channels;
     PyObject        *listeners;
+    /* totals of every object of the session */
+    PYLIBSSH2_STATS stats;
 } PYLIBSSH2_SESSION;
 
+/* socket descriptor of a session created by this module, -1 if unknown */
+extern int PYLIBSSH2_Session_fileno(LIBSSH2_SESSION *session);
+
 #endif /* _PYLIBSSH2_SESSION_H_ */
@@ -22,9 +22,6 @@
 #define PYLIBSSH2_MODULE
 #include "pylibssh2.h"
 
-void libssh2_sftp_errno_to_exception(int err);
-const char* libssh2_sftp_errno_to_str(int err);
-
 /* {{{ PYLIBSSH2_Sftp_open_dir
  */
 static char PYLIBSSH2_Sftp_open_dir_doc[] = "\n\
@@ -43,6 +40,8 @@ PYLIBSSH2_Sftp_open_dir(PYLIBSSH2_SFTP *self, PyObject *args)
     int sftp_err;
     char* errmsg;
     int rc;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -53,9 +52,13 @@ PYLIBSSH2_Sftp_open_dir(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     handle = libssh2_sftp_opendir(self->sftp, path);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_SFTP_OPEN, path, start, end,
+                 handle == NULL ? libssh2_session_last_errno(self->session) : 0, 0, 0);
 
     if (handle == NULL) {
         rc = libssh2_session_last_error(self->session, &errmsg, NULL, 0);
@@ -78,7 +81,7 @@ PYLIBSSH2_Sftp_open_dir(PYLIBSSH2_SFTP *self, PyObject *args)
                 return NULL;
 
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block: %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -88,6 +91,7 @@ PYLIBSSH2_Sftp_open_dir(PYLIBSSH2_SFTP *self, PyObject *args)
     }
     PyObject *channel = (PyObject *) PYLIBSSH2_Sftpdir_New(self->session, self->sftp, handle);
     if(channel) {
+        stats_set_path(&((PYLIBSSH2_SFTPDIR *)channel)->stats, path);
         PySet_Add(self->directories, channel);
     }
     return channel;
@@ -114,6 +118,8 @@ PYLIBSSH2_Sftp_open_file(PYLIBSSH2_SFTP *self, PyObject *args)
     int sftp_err;
     char* errmsg;
     int rc;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -124,9 +130,13 @@ PYLIBSSH2_Sftp_open_file(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     handle = libssh2_sftp_open(self->sftp, path, get_flags(flags), mode);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_SFTP_OPEN, path, start, end,
+                 handle == NULL ? libssh2_session_last_errno(self->session) : 0, 0, 0);
 
     if (handle == NULL) {
         rc = libssh2_session_last_error(self->session, &errmsg, NULL, 0);
@@ -149,7 +159,7 @@ PYLIBSSH2_Sftp_open_file(PYLIBSSH2_SFTP *self, PyObject *args)
                 return NULL;
 
             case LIBSSH2_ERROR_EAGAIN:
-                PyErr_Format(PYLIBSSH2_Error, "Marked for non-blocking I/O but the call would block: %s", errmsg);
+                set_would_block(self->session, errmsg);
                 return NULL;
 
             default:
@@ -160,6 +170,7 @@ PYLIBSSH2_Sftp_open_file(PYLIBSSH2_SFTP *self, PyObject *args)
 
     PyObject *channel = (PyObject *)PYLIBSSH2_Sftpfile_New(self->session, self->sftp, handle);
     if(channel) {
+        stats_set_path(&((PYLIBSSH2_SFTPFILE *)channel)->stats, path);
         PySet_Add(self->files, channel);
     }
     return channel;
@@ -213,6 +224,8 @@ PYLIBSSH2_Sftp_unlink(PYLIBSSH2_SFTP *self, PyObject *args)
     char *path;
     int sftp_err;
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -223,9 +236,12 @@ PYLIBSSH2_Sftp_unlink(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_unlink(self->sftp, path);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, path, start, end, rc, 0, 0);
 
     if (rc) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -249,6 +265,10 @@ PYLIBSSH2_Sftp_unlink(PYLIBSSH2_SFTP *self, PyObject *args)
                 libssh2_sftp_errno_to_exception(sftp_err); // //PyErr_Format(PYLIBSSH2_Error, "An invalid SFTP protocol response was received on the socket, or an SFTP operation caused an errorcode to be returned by the server %s: %s", libssh2_sftp_errno_to_str(sftp_err), errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Error while unlink an SFTP file %i: %s", rc, errmsg);
                 return NULL;
@@ -276,6 +296,8 @@ PYLIBSSH2_Sftp_rename(PYLIBSSH2_SFTP *self, PyObject *args)
     int rc, sftp_err;
     char *src, *dst;
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -286,9 +308,12 @@ PYLIBSSH2_Sftp_rename(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_rename(self->sftp, src, dst);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, src, start, end, rc, 0, 0);
 
     if (rc < 0) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -312,6 +337,10 @@ PYLIBSSH2_Sftp_rename(PYLIBSSH2_SFTP *self, PyObject *args)
                 libssh2_sftp_errno_to_exception(sftp_err); // PyErr_Format(PYLIBSSH2_Error, "An invalid SFTP protocol response was received on the socket, or an SFTP operation caused an errorcode to be returned by the server %s: %s", libssh2_sftp_errno_to_str(sftp_err), errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Error while renaming an SFTP file %i: %s", rc, errmsg);
                 return NULL;
@@ -340,6 +369,8 @@ PYLIBSSH2_Sftp_mkdir(PYLIBSSH2_SFTP *self, PyObject *args)
     char *path;
     long mode = 0755;
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -350,9 +381,12 @@ PYLIBSSH2_Sftp_mkdir(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_mkdir(self->sftp, path, mode);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, path, start, end, rc, 0, 0);
 
     if (rc) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -376,6 +410,10 @@ PYLIBSSH2_Sftp_mkdir(PYLIBSSH2_SFTP *self, PyObject *args)
                 libssh2_sftp_errno_to_exception(sftp_err); // PyErr_Format(PYLIBSSH2_Error, "An invalid SFTP protocol response was received on the socket, or an SFTP operation caused an errorcode to be returned by the server %s: %s", libssh2_sftp_errno_to_str(sftp_err), errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Error while creating a directory on the remote file system %i: %s", rc, errmsg);
                 return NULL;
@@ -403,6 +441,8 @@ PYLIBSSH2_Sftp_rmdir(PYLIBSSH2_SFTP *self, PyObject *args)
     int rc, sftp_err;
     char *path;
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -413,9 +453,12 @@ PYLIBSSH2_Sftp_rmdir(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_rmdir(self->sftp, path);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, path, start, end, rc, 0, 0);
 
     if (rc < 0) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -439,6 +482,10 @@ PYLIBSSH2_Sftp_rmdir(PYLIBSSH2_SFTP *self, PyObject *args)
                 libssh2_sftp_errno_to_exception(sftp_err); // PyErr_Format(PYLIBSSH2_Error, "An invalid SFTP protocol response was received on the socket, or an SFTP operation caused an errorcode to be returned by the server %s: %s", libssh2_sftp_errno_to_str(sftp_err), errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Error while removing an SFTP directory %i: %s", rc, errmsg);
                 return NULL;
@@ -467,6 +514,8 @@ PYLIBSSH2_Sftp_realpath(PYLIBSSH2_SFTP *self, PyObject *args)
     char *path;
     char target[target_len];
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -477,9 +526,12 @@ PYLIBSSH2_Sftp_realpath(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_realpath(self->sftp, path, target, target_len);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, path, start, end, rc, 0, 0);
 
     if (rc < 0) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -507,6 +559,10 @@ PYLIBSSH2_Sftp_realpath(PYLIBSSH2_SFTP *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_BUFFER_TOO_SMALL: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Error while realpath %i: %s", rc, errmsg);
                 return NULL;
@@ -534,6 +590,8 @@ PYLIBSSH2_Sftp_readlink(PYLIBSSH2_SFTP *self, PyObject *args)
     char *path;
     char target[target_len];
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -544,9 +602,12 @@ PYLIBSSH2_Sftp_readlink(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_readlink(self->sftp, path, target, target_len);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, path, start, end, rc, 0, 0);
 
     if (rc < 0) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -574,6 +635,10 @@ PYLIBSSH2_Sftp_readlink(PYLIBSSH2_SFTP *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_BUFFER_TOO_SMALL: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Error while readlink %i: %s", rc, errmsg);
                 return NULL;
@@ -600,6 +665,8 @@ PYLIBSSH2_Sftp_symlink(PYLIBSSH2_SFTP *self, PyObject *args)
     int rc, sftp_err;
     char *path, *target;
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -610,9 +677,12 @@ PYLIBSSH2_Sftp_symlink(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_symlink(self->sftp, path, target);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, path, start, end, rc, 0, 0);
 
     if (rc < 0) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -640,6 +710,10 @@ PYLIBSSH2_Sftp_symlink(PYLIBSSH2_SFTP *self, PyObject *args)
                 PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_BUFFER_TOO_SMALL: %s", errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unable to sftp symlink %i: %s", rc, errmsg);
                 return NULL;
@@ -670,6 +744,8 @@ PYLIBSSH2_Sftp_get_stat(PYLIBSSH2_SFTP *self, PyObject *args)
     int type = LIBSSH2_SFTP_STAT;
     LIBSSH2_SFTP_ATTRIBUTES attr;
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -680,9 +756,12 @@ PYLIBSSH2_Sftp_get_stat(PYLIBSSH2_SFTP *self, PyObject *args)
         return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_stat_ex(self->sftp, path, path_len, type, &attr);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_STAT, path, start, end, rc, 0, 0);
 
     if (rc < 0) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -706,13 +785,44 @@ PYLIBSSH2_Sftp_get_stat(PYLIBSSH2_SFTP *self, PyObject *args)
                 libssh2_sftp_errno_to_exception(sftp_err); // PyErr_Format(PYLIBSSH2_Error, "An invalid SFTP protocol response was received on the socket, or an SFTP operation caused an errorcode to be returned by the server %s: %s", libssh2_sftp_errno_to_str(sftp_err), errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unable to get stat %i: %s", rc, errmsg);
                 return NULL;
         }
     }
 
-    return sftp_attrs_to_statdict(&attr);
+    return (PyObject *)PYLIBSSH2_SftpAttributes_New(&attr);
+}
+/* }}} */
+
+/* {{{ mapping_get_ulong
+ * reads an integer, or a float time truncated, from a dict or SftpAttributes
+ */
+static int
+mapping_get_ulong(PyObject *mapping, char *key, unsigned long *value)
+{
+    PyObject *item, *number;
+
+    item = PyMapping_GetItemString(mapping, key);
+    if (item == NULL) {
+        return -1;
+    }
+    number = PyNumber_Long(item);
+    Py_DECREF(item);
+    if (number == NULL) {
+        return -1;
+    }
+    *value = PyLong_AsUnsignedLong(number);
+    Py_DECREF(number);
+    if (*value == (unsigned long)-1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    return 0;
 }
 /* }}} */
 
@@ -733,6 +843,8 @@ PYLIBSSH2_Sftp_set_stat(PYLIBSSH2_SFTP *self, PyObject *args)
     LIBSSH2_SFTP_ATTRIBUTES attr;
     PyObject *attrs;
     char* errmsg;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->sftp == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
@@ -746,34 +858,33 @@ PYLIBSSH2_Sftp_set_stat(PYLIBSSH2_SFTP *self, PyObject *args)
     attr.flags = 0;
     if (PyMapping_HasKeyString(attrs, "st_mode")) {
         attr.flags |= LIBSSH2_SFTP_ATTR_PERMISSIONS;
-        attr.permissions = PyLong_AsLong(PyDict_GetItemString(attrs, "st_mode"));
+        if (mapping_get_ulong(attrs, "st_mode", &attr.permissions) < 0) {
+            return NULL;
+        }
     }
 
     if (PyMapping_HasKeyString(attrs, "st_uid") && PyMapping_HasKeyString(attrs, "st_gid")) {
-        if (PyMapping_HasKeyString(attrs, "st_uid")) {
-            attr.flags |= LIBSSH2_SFTP_ATTR_UIDGID;
-            attr.uid = PyLong_AsLong(PyDict_GetItemString(attrs, "st_uid"));
-        }
-        if (PyMapping_HasKeyString(attrs, "st_gid")) {
-            attr.flags |= LIBSSH2_SFTP_ATTR_UIDGID;
-            attr.uid = PyLong_AsLong(PyDict_GetItemString(attrs, "st_gid"));
+        attr.flags |= LIBSSH2_SFTP_ATTR_UIDGID;
+        if (mapping_get_ulong(attrs, "st_uid", &attr.uid) < 0 ||
+            mapping_get_ulong(attrs, "st_gid", &attr.gid) < 0) {
+            return NULL;
         }
     }
 
     if (PyMapping_HasKeyString(attrs, "st_atime") && PyMapping_HasKeyString(attrs, "st_mtime")) {
-        if (PyMapping_HasKeyString(attrs, "st_atime")) {
-            attr.flags |= LIBSSH2_SFTP_ATTR_ACMODTIME;
-            attr.uid = PyLong_AsLong(PyDict_GetItemString(attrs, "st_atime"));
-        }
-        if (PyMapping_HasKeyString(attrs, "st_mtime")) {
-            attr.flags |= LIBSSH2_SFTP_ATTR_ACMODTIME;
-            attr.uid = PyLong_AsLong(PyDict_GetItemString(attrs, "st_mtime"));
+        attr.flags |= LIBSSH2_SFTP_ATTR_ACMODTIME;
+        if (mapping_get_ulong(attrs, "st_atime", &attr.atime) < 0 ||
+            mapping_get_ulong(attrs, "st_mtime", &attr.mtime) < 0) {
+            return NULL;
         }
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_setstat(self->sftp, path, &attr);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_STAT, path, start, end, rc, 0, 0);
 
     if (rc < 0) {
         if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
@@ -797,6 +908,10 @@ PYLIBSSH2_Sftp_set_stat(PYLIBSSH2_SFTP *self, PyObject *args)
                 libssh2_sftp_errno_to_exception(sftp_err); // PyErr_Format(PYLIBSSH2_Error, "An invalid SFTP protocol response was received on the socket, or an SFTP operation caused an errorcode to be returned by the server %s: %s", libssh2_sftp_errno_to_str(sftp_err), errmsg);
                 return NULL;
 
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
             default:
                 PyErr_Format(PYLIBSSH2_Error, "Unable to set file stat %i: %s", rc, errmsg);
                 return NULL;
@@ -872,6 +987,375 @@ PYLIBSSH2_Sftp_close_file(PYLIBSSH2_SFTP *self, PyObject *args)
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Sftp_list_dirs
+ */
+enum {
+    LIST_DIRS_IDLE,
+    LIST_DIRS_OPENING,
+    LIST_DIRS_READING,
+    LIST_DIRS_CLOSING
+};
+
+/* entries of one directory, gathered without the GIL */
+typedef struct {
+    char                    *names;
+    size_t                   names_used;
+    size_t                   names_size;
+    PYLIBSSH2_SFTPDIR_ENTRY *entries;
+    int                      count;
+    int                      entries_size;
+    int                      finished;
+    int                      rc;
+    int                      sftp_err;
+} LIST_DIRS_RESULT;
+
+/* one SFTP channel working through the paths */
+typedef struct {
+    LIBSSH2_SFTP         *sftp;
+    LIBSSH2_SFTP_HANDLE  *handle;
+    int                   state;
+    int                   path;
+} LIST_DIRS_LISTER;
+
+static int
+list_dirs_read(LIST_DIRS_RESULT *result, LIBSSH2_SFTP_HANDLE *handle)
+{
+    int rc;
+
+    while (1) {
+        if (result->names_size - result->names_used < PYLIBSSH2_SFTP_NAME_MAX) {
+            size_t size = result->names_size ? result->names_size * 2 : 4 * PYLIBSSH2_SFTP_NAME_MAX;
+            char *names = realloc(result->names, size);
+            if (names == NULL) {
+                return LIBSSH2_ERROR_ALLOC;
+            }
+            result->names = names;
+            result->names_size = size;
+        }
+        if (result->count == result->entries_size) {
+            int size = result->entries_size ? result->entries_size * 2 : 64;
+            PYLIBSSH2_SFTPDIR_ENTRY *entries = realloc(result->entries, size * sizeof(PYLIBSSH2_SFTPDIR_ENTRY));
+            if (entries == NULL) {
+                return LIBSSH2_ERROR_ALLOC;
+            }
+            result->entries = entries;
+            result->entries_size = size;
+        }
+
+        rc = libssh2_sftp_readdir(handle, result->names + result->names_used,
+                                  PYLIBSSH2_SFTP_NAME_MAX, &result->entries[result->count].attrs);
+        if (rc <= 0) {
+            return rc;
+        }
+        result->entries[result->count].offset = result->names_used;
+        result->entries[result->count].length = rc;
+        result->names_used += rc;
+        result->count++;
+    }
+}
+
+/*
+ * Brings a lister left by a timeout back to idle. Its SFTP channel still
+ * waits on a request, the next call of that kind on the channel would
+ * take its reply, so the pending call is finished in blocking mode and
+ * the handle closed.
+ */
+static void
+list_dirs_abandon(LIST_DIRS_LISTER *lister, PyObject *path_seq)
+{
+    char name[PYLIBSSH2_SFTP_NAME_MAX];
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    PyObject *path;
+
+    if (lister->state == LIST_DIRS_OPENING) {
+        path = PyTuple_GET_ITEM(path_seq, lister->path);
+        lister->handle = libssh2_sftp_open_ex(lister->sftp, PyString_AS_STRING(path),
+            PyString_GET_SIZE(path), 0, 0, LIBSSH2_SFTP_OPENDIR);
+    } else if (lister->state == LIST_DIRS_READING) {
+        libssh2_sftp_readdir(lister->handle, name, sizeof(name), &attrs);
+    }
+    if (lister->handle != NULL) {
+        libssh2_sftp_close_handle(lister->handle);
+        lister->handle = NULL;
+    }
+    lister->state = LIST_DIRS_IDLE;
+}
+
+static PyObject *
+list_dirs_error(int rc, int sftp_err)
+{
+    PyObject *type, *value, *traceback;
+
+    if (rc == LIBSSH2_ERROR_SFTP_PROTOCOL) {
+        libssh2_sftp_errno_to_exception(sftp_err);
+    } else if (rc == LIBSSH2_ERROR_SOCKET_TIMEOUT) {
+        PyErr_Format(PYLIBSSH2_Error, "Timed out listing sftp directory.");
+    } else {
+        PyErr_Format(PYLIBSSH2_Error, "Unable to list sftp directory %i", rc);
+    }
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+
+    return value;
+}
+
+static char PYLIBSSH2_Sftp_list_dirs_doc[] = "\n\
+list_dirs(paths, [helpers]) -> list\n\
+\n\
+Lists several directories at once. libssh2 keeps one pending request per\n\
+SFTP channel, so this channel and every helper channel of the same\n\
+session each work on one directory, driven round robin in non-blocking\n\
+mode with the GIL released. The session is back in its blocking mode on\n\
+return. On a timeout the requests in flight are finished in blocking\n\
+mode and their handles closed, the Sftp objects stay usable.\n\
+\n\
+@param paths: directories to list\n\
+@type paths: list of str\n\
+@param helpers: other Sftp objects of this session\n\
+@type helpers: list of Sftp\n\
+\n\
+@return: one item per path, a list of (name, SftpAttributes) or the\n\
+exception that failed the listing\n\
+@rtype: list\n\
+";
+
+static PyObject *
+PYLIBSSH2_Sftp_list_dirs(PYLIBSSH2_SFTP *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    PyObject *paths;
+    PyObject *helpers = NULL;
+    PyObject *path_seq = NULL;
+    PyObject *helper_seq = NULL;
+    PyObject *list = NULL;
+    LIST_DIRS_RESULT *results = NULL;
+    LIST_DIRS_LISTER *listers = NULL;
+    int npaths, nlisters, next = 0, done = 0;
+    int fd, blocking, timeout, progress, rc;
+    int i, j;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if(self->sftp == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftp object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "O|O:list_dirs", &paths, &helpers)) {
+        return NULL;
+    }
+
+    /* a tuple of our own, read without the GIL */
+    path_seq = PySequence_Tuple(paths);
+    if (path_seq == NULL) {
+        goto error;
+    }
+    npaths = PyTuple_GET_SIZE(path_seq);
+    for (i = 0; i < npaths; i++) {
+        if (!PyString_Check(PyTuple_GET_ITEM(path_seq, i))) {
+            PyErr_SetString(PyExc_TypeError, "paths must be strings");
+            goto error;
+        }
+    }
+
+    nlisters = 1;
+    if (helpers != NULL && helpers != Py_None) {
+        helper_seq = PySequence_Fast(helpers, "helpers must be a sequence");
+        if (helper_seq == NULL) {
+            goto error;
+        }
+        for (i = 0; i < PySequence_Fast_GET_SIZE(helper_seq); i++) {
+            PYLIBSSH2_SFTP *helper = (PYLIBSSH2_SFTP *)PySequence_Fast_GET_ITEM(helper_seq, i);
+            if (!PYLIBSSH2_Sftp_Check(helper)) {
+                PyErr_SetString(PyExc_TypeError, "helpers must be Sftp objects");
+                goto error;
+            }
+            if (helper->sftp == NULL || helper->session != self->session) {
+                PyErr_SetString(PyExc_ValueError, "helpers must be open Sftp objects of the same session");
+                goto error;
+            }
+        }
+        nlisters += PySequence_Fast_GET_SIZE(helper_seq);
+    }
+
+    fd = PYLIBSSH2_Session_fileno(self->session);
+    if (fd < 0) {
+        PyErr_SetString(PYLIBSSH2_Error, "Unable to find the socket of the session.");
+        goto error;
+    }
+
+    results = calloc(npaths ? npaths : 1, sizeof(LIST_DIRS_RESULT));
+    listers = calloc(nlisters, sizeof(LIST_DIRS_LISTER));
+    if (results == NULL || listers == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    listers[0].sftp = self->sftp;
+    for (i = 1; i < nlisters; i++) {
+        listers[i].sftp = ((PYLIBSSH2_SFTP *)PySequence_Fast_GET_ITEM(helper_seq, i - 1))->sftp;
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    blocking = libssh2_session_get_blocking(self->session);
+    timeout = libssh2_session_get_timeout(self->session);
+    libssh2_session_set_blocking(self->session, 0);
+
+    while (done < npaths) {
+        progress = 0;
+        for (i = 0; i < nlisters; i++) {
+            LIST_DIRS_LISTER *lister = &listers[i];
+            LIST_DIRS_RESULT *result;
+
+            if (lister->state == LIST_DIRS_IDLE) {
+                if (next == npaths) {
+                    continue;
+                }
+                lister->path = next++;
+                lister->state = LIST_DIRS_OPENING;
+            }
+            result = &results[lister->path];
+
+            if (lister->state == LIST_DIRS_OPENING) {
+                PyObject *path = PyTuple_GET_ITEM(path_seq, lister->path);
+                lister->handle = libssh2_sftp_open_ex(lister->sftp, PyString_AS_STRING(path),
+                    PyString_GET_SIZE(path), 0, 0, LIBSSH2_SFTP_OPENDIR);
+                if (lister->handle == NULL) {
+                    rc = libssh2_session_last_errno(self->session);
+                    if (rc == LIBSSH2_ERROR_EAGAIN) {
+                        continue;
+                    }
+                    result->rc = rc ? rc : LIBSSH2_ERROR_SFTP_PROTOCOL;
+                    result->sftp_err = libssh2_sftp_last_error(lister->sftp);
+                    result->finished = 1;
+                    lister->state = LIST_DIRS_IDLE;
+                    done++;
+                    progress = 1;
+                    continue;
+                }
+                lister->state = LIST_DIRS_READING;
+                progress = 1;
+            }
+
+            if (lister->state == LIST_DIRS_READING) {
+                int count = result->count;
+                rc = list_dirs_read(result, lister->handle);
+                if (result->count != count) {
+                    progress = 1;
+                }
+                if (rc == LIBSSH2_ERROR_EAGAIN) {
+                    continue;
+                }
+                if (rc < 0) {
+                    result->rc = rc;
+                    result->sftp_err = libssh2_sftp_last_error(lister->sftp);
+                }
+                lister->state = LIST_DIRS_CLOSING;
+                progress = 1;
+            }
+
+            if (lister->state == LIST_DIRS_CLOSING) {
+                rc = libssh2_sftp_close_handle(lister->handle);
+                if (rc == LIBSSH2_ERROR_EAGAIN) {
+                    continue;
+                }
+                lister->handle = NULL;
+                result->finished = 1;
+                lister->state = LIST_DIRS_IDLE;
+                done++;
+                progress = 1;
+            }
+        }
+
+        if (!progress && done < npaths &&
+            wait_socket(fd, self->session, timeout ? timeout : -1) == 0) {
+            for (j = 0; j < npaths; j++) {
+                if (!results[j].finished) {
+                    results[j].rc = LIBSSH2_ERROR_SOCKET_TIMEOUT;
+                }
+            }
+            libssh2_session_set_blocking(self->session, 1);
+            for (i = 0; i < nlisters; i++) {
+                list_dirs_abandon(&listers[i], path_seq);
+            }
+            break;
+        }
+    }
+
+    libssh2_session_set_blocking(self->session, blocking);
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_READDIR, NULL, start, end, 0, 0, 0);
+
+    list = PyList_New(npaths);
+    if (list == NULL) {
+        goto error;
+    }
+    for (i = 0; i < npaths; i++) {
+        PyObject *item;
+        LIST_DIRS_RESULT *result = &results[i];
+
+        if (result->rc < 0) {
+            item = list_dirs_error(result->rc, result->sftp_err);
+        } else {
+            item = PyList_New(result->count);
+            for (j = 0; item != NULL && j < result->count; j++) {
+                PyObject *entry = Py_BuildValue("(s#N)", result->names + result->entries[j].offset,
+                                                (int)result->entries[j].length,
+                                                PYLIBSSH2_SftpAttributes_New(&result->entries[j].attrs));
+                if (entry == NULL) {
+                    Py_CLEAR(item);
+                    break;
+                }
+                PyList_SET_ITEM(item, j, entry);
+            }
+        }
+        if (item == NULL) {
+            Py_CLEAR(list);
+            goto error;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+
+error:
+    if (results != NULL) {
+        for (i = 0; i < npaths; i++) {
+            free(results[i].names);
+            free(results[i].entries);
+        }
+        free(results);
+    }
+    free(listers);
+    Py_XDECREF(path_seq);
+    Py_XDECREF(helper_seq);
+
+    return list;
+}
+/* }}} */
+/* {{{ PYLIBSSH2_Sftp_stats
+ */
+static char PYLIBSSH2_Sftp_stats_doc[] = "\n\
+stats() -> dict\n\
+\n\
+Returns the counters of the metadata calls made on this Sftp object\n\
+(open, stat, rename...): calls, bytes_read, bytes_written, eagain, errors\n\
+and blocked_ns, the time spent inside libssh2 in nanoseconds. Reads and\n\
+writes are counted on the Sftpfile and Sftpdir objects.\n\
+\n\
+@return counters since the object was created, and its id in the traces\n\
+@rtype  dict";
+
+static PyObject *
+PYLIBSSH2_Sftp_stats(PYLIBSSH2_SFTP *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    return stats_to_dict(&self->stats);
+}
+/* }}} */
+
+
 /* {{{ PYLIBSSH2_Sftp_methods[]
  *
  * ADD_METHOD(name) expands to a correct PyMethodDef declaration
@@ -895,6 +1379,8 @@ static PyMethodDef PYLIBSSH2_Sftp_methods[] = {
     ADD_METHOD(symlink),
     ADD_METHOD(get_stat),
     ADD_METHOD(set_stat),
+    ADD_METHOD(list_dirs),
+    ADD_METHOD(stats),
     { NULL, NULL }
 };
 #undef ADD_METHOD
@@ -919,6 +1405,7 @@ PYLIBSSH2_Sftp_New(LIBSSH2_SESSION *session, LIBSSH2_SFTP *sftp)
 
     self->session = session;
     self->sftp = sftp;
+    stats_init(&self->stats);
     self->directories = PySet_New(0);
     self->files = PySet_New(0);
     return self;
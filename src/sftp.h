@@ -23,6 +23,7 @@
 
 #include <Python.h>
 #include <libssh2.h>
+#include "stats.h"
 #include "sftpfile.h"
 #include "sftpdir.h"
 
@@ -38,8 +39,13 @@ typedef struct {
     LIBSSH2_SFTP     *sftp;
     PyObject         *directories;
     PyObject         *files;
+    /* metadata operations */
+    PYLIBSSH2_STATS  stats;
 } PYLIBSSH2_SFTP;
 
 extern void Sftp_shutdown(PYLIBSSH2_SFTP *self);
 
+extern void libssh2_sftp_errno_to_exception(int err);
+extern const char* libssh2_sftp_errno_to_str(int err);
+
 #endif /* _PYLIBSSH2_SFTP_H_ */
@@ -0,0 +1,564 @@
+/*-
+ * pylibssh2 - python bindings for libssh2 library
+ *
+ * Copyright (C) 2010 Wallix Inc.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <Python.h>
+#define PYLIBSSH2_MODULE
+#include "pylibssh2.h"
+
+enum {
+    FIELD_SIZE,
+    FIELD_UID,
+    FIELD_GID,
+    FIELD_MODE,
+    FIELD_ATIME,
+    FIELD_MTIME,
+    FIELD_FLAGS
+};
+
+static char *field_names[PYLIBSSH2_SFTPATTRIBUTES_FIELDS] = {
+    "st_size",
+    "st_uid",
+    "st_gid",
+    "st_mode",
+    "st_atime",
+    "st_mtime",
+    "st_flags"
+};
+
+/* tuple of the interned field names, shared by every object */
+static PyObject *field_keys = NULL;
+
+/* {{{ field_index
+ * returns the field of a key, -1 without exception when unknown
+ */
+static int
+field_index(PyObject *key)
+{
+    int i;
+    char *name;
+
+    if (PyString_Check(key)) {
+        for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+            if (key == PyTuple_GET_ITEM(field_keys, i)) {
+                return i;
+            }
+        }
+        name = PyString_AS_STRING(key);
+        for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+            if (strcmp(name, field_names[i]) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    if (PyInt_Check(key) || PyLong_Check(key)) {
+        Py_ssize_t index = PyNumber_AsSsize_t(key, NULL);
+        if (index < 0) {
+            index += PYLIBSSH2_SFTPATTRIBUTES_FIELDS;
+        }
+        if (index >= 0 && index < PYLIBSSH2_SFTPATTRIBUTES_FIELDS) {
+            return (int)index;
+        }
+    }
+
+    return -1;
+}
+/* }}} */
+
+/* {{{ field_get
+ * returns a new reference to a field, boxing it on first access
+ */
+static PyObject *
+field_get(PYLIBSSH2_SFTPATTRIBUTES *self, int index)
+{
+    PyObject *value = self->fields[index];
+    LIBSSH2_SFTP_ATTRIBUTES *attrs = &self->attrs;
+
+    if (value == NULL) {
+        switch (index) {
+            case FIELD_SIZE:
+                value = PyLong_FromUnsignedLongLong(attrs->filesize);
+                break;
+            case FIELD_UID:
+                value = PyLong_FromUnsignedLong(attrs->uid);
+                break;
+            case FIELD_GID:
+                value = PyLong_FromUnsignedLong(attrs->gid);
+                break;
+            case FIELD_MODE:
+                value = PyLong_FromUnsignedLong(attrs->permissions);
+                break;
+            case FIELD_ATIME:
+                if (self->float_times) {
+                    value = PyFloat_FromDouble(attrs->atime + self->atime_nsec * 0.000000001);
+                } else {
+                    value = PyLong_FromUnsignedLong(attrs->atime);
+                }
+                break;
+            case FIELD_MTIME:
+                if (self->float_times) {
+                    value = PyFloat_FromDouble(attrs->mtime + self->mtime_nsec * 0.000000001);
+                } else {
+                    value = PyLong_FromUnsignedLong(attrs->mtime);
+                }
+                break;
+            default:
+                value = PyLong_FromUnsignedLong(attrs->flags);
+                break;
+        }
+        if (value == NULL) {
+            return NULL;
+        }
+        self->fields[index] = value;
+    }
+
+    Py_INCREF(value);
+    return value;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_SftpAttributes_keys
+ */
+static char PYLIBSSH2_SftpAttributes_keys_doc[] = "\n\
+keys() -> list\n\
+\n\
+@return: the field names, as dict.keys\n\
+@rtype: list\n\
+";
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_keys(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *args)
+{
+    return PySequence_List(field_keys);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_SftpAttributes_values
+ */
+static char PYLIBSSH2_SftpAttributes_values_doc[] = "\n\
+values() -> list\n\
+\n\
+@return: the field values, in the order of keys\n\
+@rtype: list\n\
+";
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_values(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *args)
+{
+    int i;
+    PyObject *list = PyList_New(PYLIBSSH2_SFTPATTRIBUTES_FIELDS);
+
+    if (list == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+        PyObject *value = field_get(self, i);
+        if (value == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, value);
+    }
+
+    return list;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_SftpAttributes_items
+ */
+static char PYLIBSSH2_SftpAttributes_items_doc[] = "\n\
+items() -> list\n\
+\n\
+@return: the (name, value) pairs, as dict.items\n\
+@rtype: list\n\
+";
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_items(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *args)
+{
+    int i;
+    PyObject *list = PyList_New(PYLIBSSH2_SFTPATTRIBUTES_FIELDS);
+
+    if (list == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+        PyObject *item = Py_BuildValue("(ON)", PyTuple_GET_ITEM(field_keys, i), field_get(self, i));
+        if (item == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+
+    return list;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_SftpAttributes_get
+ */
+static char PYLIBSSH2_SftpAttributes_get_doc[] = "\n\
+get(name, [default]) -> value\n\
+\n\
+@param name: field name, such as st_size\n\
+@type name: str\n\
+@param default: returned when name is not a field, None by default\n\
+\n\
+@return: the field value or default\n\
+";
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_get(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *args)
+{
+    PyObject *key;
+    PyObject *def = Py_None;
+    int index;
+
+    if (!PyArg_ParseTuple(args, "O|O:get", &key, &def)) {
+        return NULL;
+    }
+
+    index = PyString_Check(key) ? field_index(key) : -1;
+    if (index < 0) {
+        Py_INCREF(def);
+        return def;
+    }
+
+    return field_get(self, index);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_SftpAttributes_has_key
+ */
+static char PYLIBSSH2_SftpAttributes_has_key_doc[] = "\n\
+has_key(name) -> bool\n\
+\n\
+@param name: field name, such as st_size\n\
+@type name: str\n\
+\n\
+@return: True if name is a field\n\
+@rtype: bool\n\
+";
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_has_key(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *args)
+{
+    PyObject *key;
+
+    if (!PyArg_ParseTuple(args, "O:has_key", &key)) {
+        return NULL;
+    }
+
+    return PyBool_FromLong(PyString_Check(key) && field_index(key) >= 0);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_SftpAttributes_to_dict
+ */
+static char PYLIBSSH2_SftpAttributes_to_dict_doc[] = "\n\
+to_dict() -> dict\n\
+\n\
+@return: a new dict of the fields, as returned before SftpAttributes\n\
+@rtype: dict\n\
+";
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_to_dict(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *args)
+{
+    int i;
+    PyObject *dict = PyDict_New();
+
+    if (dict == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+        PyObject *value = field_get(self, i);
+        if (value == NULL || PyDict_SetItem(dict, PyTuple_GET_ITEM(field_keys, i), value) < 0) {
+            Py_XDECREF(value);
+            Py_DECREF(dict);
+            return NULL;
+        }
+        Py_DECREF(value);
+    }
+
+    return dict;
+}
+/* }}} */
+
+/*
+ * ADD_METHOD(name) expands to a correct PyMethodDef declaration
+ *   {  'name', (PyCFunction)PYLIBSSH2_SftpAttributes_name, METH_VARARGS }
+ * for convenience
+ */
+#define ADD_METHOD(name) \
+{ #name, (PyCFunction)PYLIBSSH2_SftpAttributes_##name, METH_VARARGS, PYLIBSSH2_SftpAttributes_##name##_doc }
+
+static PyMethodDef PYLIBSSH2_SftpAttributes_methods[] =
+{
+    ADD_METHOD(keys),
+    ADD_METHOD(values),
+    ADD_METHOD(items),
+    ADD_METHOD(get),
+    ADD_METHOD(has_key),
+    ADD_METHOD(to_dict),
+    { NULL, NULL }
+};
+#undef ADD_METHOD
+
+PYLIBSSH2_SFTPATTRIBUTES *
+PYLIBSSH2_SftpAttributes_New(LIBSSH2_SFTP_ATTRIBUTES *attrs)
+{
+    PRINTFUNCNAME
+    PYLIBSSH2_SFTPATTRIBUTES *self;
+
+    self = PyObject_New(PYLIBSSH2_SFTPATTRIBUTES, &PYLIBSSH2_SftpAttributes_Type);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    self->attrs = *attrs;
+    self->float_times = 0;
+    self->atime_nsec = 0;
+    self->mtime_nsec = 0;
+    memset(self->fields, 0, sizeof(self->fields));
+
+    return self;
+}
+
+PyObject *
+PYLIBSSH2_SftpAttributes_FromStat(struct stat *st)
+{
+    PRINTFUNCNAME
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    PYLIBSSH2_SFTPATTRIBUTES *self;
+
+    attrs.flags = LIBSSH2_SFTP_ATTR_SIZE | LIBSSH2_SFTP_ATTR_UIDGID |
+                  LIBSSH2_SFTP_ATTR_PERMISSIONS | LIBSSH2_SFTP_ATTR_ACMODTIME;
+    attrs.filesize = st->st_size;
+    attrs.uid = st->st_uid;
+    attrs.gid = st->st_gid;
+    attrs.permissions = st->st_mode;
+    attrs.atime = st->st_atim.tv_sec;
+    attrs.mtime = st->st_mtim.tv_sec;
+
+    self = PYLIBSSH2_SftpAttributes_New(&attrs);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->float_times = 1;
+    self->atime_nsec = st->st_atim.tv_nsec;
+    self->mtime_nsec = st->st_mtim.tv_nsec;
+
+    return (PyObject *)self;
+}
+
+static void
+PYLIBSSH2_SftpAttributes_dealloc(PYLIBSSH2_SFTPATTRIBUTES *self)
+{
+    int i;
+
+    for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+        Py_XDECREF(self->fields[i]);
+    }
+    PyObject_Del(self);
+}
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_getattr(PYLIBSSH2_SFTPATTRIBUTES *self, char *name)
+{
+    int i;
+
+    if (name[0] == 's' && name[1] == 't' && name[2] == '_') {
+        for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+            if (strcmp(name, field_names[i]) == 0) {
+                return field_get(self, i);
+            }
+        }
+    }
+
+    return Py_FindMethod(PYLIBSSH2_SftpAttributes_methods, (PyObject *)self, name);
+}
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_repr(PYLIBSSH2_SFTPATTRIBUTES *self)
+{
+    PyObject *dict, *dict_repr, *repr;
+
+    dict = PYLIBSSH2_SftpAttributes_to_dict(self, NULL);
+    if (dict == NULL) {
+        return NULL;
+    }
+    dict_repr = PyObject_Repr(dict);
+    Py_DECREF(dict);
+    if (dict_repr == NULL) {
+        return NULL;
+    }
+    repr = PyString_FromFormat("SftpAttributes(%s)", PyString_AS_STRING(dict_repr));
+    Py_DECREF(dict_repr);
+
+    return repr;
+}
+
+/*
+ * Equal to an SftpAttributes or a dict with the same fields, as the dict
+ * get_stat used to return.
+ */
+static PyObject *
+PYLIBSSH2_SftpAttributes_richcompare(PyObject *self, PyObject *other, int op)
+{
+    PyObject *dict, *other_dict, *result;
+
+    if ((op != Py_EQ && op != Py_NE) ||
+        !(PYLIBSSH2_SftpAttributes_Check(other) || PyDict_Check(other))) {
+        Py_INCREF(Py_NotImplemented);
+        return Py_NotImplemented;
+    }
+
+    dict = PYLIBSSH2_SftpAttributes_to_dict((PYLIBSSH2_SFTPATTRIBUTES *)self, NULL);
+    if (dict == NULL) {
+        return NULL;
+    }
+    if (PYLIBSSH2_SftpAttributes_Check(other)) {
+        other_dict = PYLIBSSH2_SftpAttributes_to_dict((PYLIBSSH2_SFTPATTRIBUTES *)other, NULL);
+        if (other_dict == NULL) {
+            Py_DECREF(dict);
+            return NULL;
+        }
+    } else {
+        Py_INCREF(other);
+        other_dict = other;
+    }
+    result = PyObject_RichCompare(dict, other_dict, op);
+    Py_DECREF(dict);
+    Py_DECREF(other_dict);
+
+    return result;
+}
+
+/* {{{ mapping and sequence protocols
+ */
+static Py_ssize_t
+PYLIBSSH2_SftpAttributes_length(PYLIBSSH2_SFTPATTRIBUTES *self)
+{
+    return PYLIBSSH2_SFTPATTRIBUTES_FIELDS;
+}
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_subscript(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *key)
+{
+    int index = field_index(key);
+
+    if (index < 0) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetObject(PyExc_KeyError, key);
+        }
+        return NULL;
+    }
+
+    return field_get(self, index);
+}
+
+static int
+PYLIBSSH2_SftpAttributes_contains(PYLIBSSH2_SFTPATTRIBUTES *self, PyObject *key)
+{
+    return PyString_Check(key) && field_index(key) >= 0;
+}
+
+static PyObject *
+PYLIBSSH2_SftpAttributes_iter(PYLIBSSH2_SFTPATTRIBUTES *self)
+{
+    return PyObject_GetIter(field_keys);
+}
+
+static PyMappingMethods PYLIBSSH2_SftpAttributes_as_mapping = {
+    (lenfunc)PYLIBSSH2_SftpAttributes_length,           /* mp_length */
+    (binaryfunc)PYLIBSSH2_SftpAttributes_subscript,     /* mp_subscript */
+    0,                                                  /* mp_ass_subscript */
+};
+
+static PySequenceMethods PYLIBSSH2_SftpAttributes_as_sequence = {
+    0,                                                  /* sq_length */
+    0,                                                  /* sq_concat */
+    0,                                                  /* sq_repeat */
+    0,                                                  /* sq_item */
+    0,                                                  /* sq_slice */
+    0,                                                  /* sq_ass_item */
+    0,                                                  /* sq_ass_slice */
+    (objobjproc)PYLIBSSH2_SftpAttributes_contains,      /* sq_contains */
+};
+/* }}} */
+
+/*
+ * see /usr/include/python2.5/object.c line 261
+ */
+PyTypeObject PYLIBSSH2_SftpAttributes_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                              /* ob_size */
+    "SftpAttributes",                               /* tp_name */
+    sizeof(PYLIBSSH2_SFTPATTRIBUTES),               /* tp_basicsize */
+    0,                                              /* tp_itemsize */
+    (destructor)PYLIBSSH2_SftpAttributes_dealloc,   /* tp_dealloc */
+    0,                                              /* tp_print */
+    (getattrfunc)PYLIBSSH2_SftpAttributes_getattr,  /* tp_getattr */
+    0,                                              /* tp_setattr */
+    0,                                              /* tp_compare */
+    (reprfunc)PYLIBSSH2_SftpAttributes_repr,        /* tp_repr */
+    0,                                              /* tp_as_number */
+    &PYLIBSSH2_SftpAttributes_as_sequence,          /* tp_as_sequence */
+    &PYLIBSSH2_SftpAttributes_as_mapping,           /* tp_as_mapping */
+    /* unhashable like the dict it compares equal to */
+    PyObject_HashNotImplemented,                    /* tp_hash  */
+    0,                                              /* tp_call */
+    0,                                              /* tp_str */
+    0,                                              /* tp_getattro */
+    0,                                              /* tp_setattro */
+    0,                                              /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                             /* tp_flags */
+    "SftpAttributes objects",                       /* tp_doc */
+    0,                                              /* tp_traverse */
+    0,                                              /* tp_clear */
+    PYLIBSSH2_SftpAttributes_richcompare,           /* tp_richcompare */
+    0,                                              /* tp_weaklistoffset */
+    (getiterfunc)PYLIBSSH2_SftpAttributes_iter,     /* tp_iter */
+};
+
+int
+init_libssh2_SftpAttributes(PyObject *dict)
+{
+    int i;
+
+    field_keys = PyTuple_New(PYLIBSSH2_SFTPATTRIBUTES_FIELDS);
+    if (field_keys == NULL) {
+        return 0;
+    }
+    for (i = 0; i < PYLIBSSH2_SFTPATTRIBUTES_FIELDS; i++) {
+        PyObject *key = PyString_InternFromString(field_names[i]);
+        if (key == NULL) {
+            return 0;
+        }
+        PyTuple_SET_ITEM(field_keys, i, key);
+    }
+
+    PYLIBSSH2_SftpAttributes_Type.ob_type = &PyType_Type;
+    Py_INCREF(&PYLIBSSH2_SftpAttributes_Type);
+    PyDict_SetItemString(dict, "SftpAttributesType", (PyObject *)&PYLIBSSH2_SftpAttributes_Type);
+
+    return 1;
+}
@@ -0,0 +1,50 @@
+/*-
+ * pylibssh2 - python bindings for libssh2 library
+ *
+ * Copyright (C) 2010 Wallix Inc.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _PYLIBSSH2_SFTPATTRIBUTES_H_
+#define _PYLIBSSH2_SFTPATTRIBUTES_H_
+
+#include <Python.h>
+#include <sys/stat.h>
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+
+extern int init_libssh2_SftpAttributes(PyObject *);
+
+extern PyTypeObject PYLIBSSH2_SftpAttributes_Type;
+
+#define PYLIBSSH2_SftpAttributes_Check(v) ((v)->ob_type == &PYLIBSSH2_SftpAttributes_Type)
+
+/* st_size, st_uid, st_gid, st_mode, st_atime, st_mtime, st_flags */
+#define PYLIBSSH2_SFTPATTRIBUTES_FIELDS 7
+
+typedef struct {
+    PyObject_HEAD
+    LIBSSH2_SFTP_ATTRIBUTES  attrs;
+    /* times come from a struct stat, boxed as float like os.stat */
+    int                      float_times;
+    long                     atime_nsec;
+    long                     mtime_nsec;
+    /* fields boxed on first access */
+    PyObject                *fields[PYLIBSSH2_SFTPATTRIBUTES_FIELDS];
+} PYLIBSSH2_SFTPATTRIBUTES;
+
+extern PyObject *PYLIBSSH2_SftpAttributes_FromStat(struct stat *st);
+
+#endif /* _PYLIBSSH2_SFTPATTRIBUTES_H_ */
@@ -53,8 +53,10 @@ PYLIBSSH2_Sftpdir_read(PYLIBSSH2_SFTPDIR *self, PyObject *args)
     PRINTFUNCNAME
     LIBSSH2_SFTP_ATTRIBUTES attrs;
     int buffer_maxlen = 0;
-    int longentry_maxlen = 255;
+    int longentry_maxlen = PYLIBSSH2_SFTP_NAME_MAX;
     PyObject *buffer;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->handle == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftpdir object has been closed/shutdown.");
@@ -63,32 +65,39 @@ PYLIBSSH2_Sftpdir_read(PYLIBSSH2_SFTPDIR *self, PyObject *args)
 
     buffer = PyString_FromStringAndSize(NULL, longentry_maxlen);
     if (buffer == NULL) {
-        Py_INCREF(Py_None);
-        return Py_None;
+        return NULL;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     buffer_maxlen = libssh2_sftp_readdir(self->handle, PyString_AsString(buffer),
                                          longentry_maxlen, &attrs);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_READDIR, NULL, start, end, buffer_maxlen,
+                 buffer_maxlen > 0 ? buffer_maxlen : 0, 0);
 
     if (buffer_maxlen == 0) {
+        Py_DECREF(buffer);
         Py_INCREF(Py_None);
         return Py_None;
-    } else if ( buffer_maxlen == -1) {
+    } else if (buffer_maxlen == LIBSSH2_ERROR_EAGAIN) {
+        Py_DECREF(buffer);
+        set_would_block(self->session, NULL);
+        return NULL;
+    } else if (buffer_maxlen < 0) {
+        Py_DECREF(buffer);
         /* CLEAN: PYLIBSSH2_SFTPDIR_CANT_READDIR_MSG */
         PyErr_SetString(PYLIBSSH2_Error, "Unable to readdir.");
         return NULL;
     }
 
-    if (buffer_maxlen != longentry_maxlen &&
-        _PyString_Resize(&buffer, buffer_maxlen) < 0) {
-        Py_INCREF(Py_None);
-        return Py_None;
+    if (_PyString_Resize(&buffer, buffer_maxlen) < 0) {
+        return NULL;
     }
 
-    PyObject *dict = sftp_attrs_to_statdict(&attrs);
-    return Py_BuildValue("NO", buffer, dict);
+    PyObject *dict = (PyObject *)PYLIBSSH2_SftpAttributes_New(&attrs);
+    return Py_BuildValue("NN", buffer, dict);
 }
 /* }}} */
 
@@ -107,9 +116,12 @@ PYLIBSSH2_Sftpdir_list_files(PYLIBSSH2_SFTPDIR *self, PyObject *args)
     PRINTFUNCNAME
     LIBSSH2_SFTP_ATTRIBUTES attrs;
     int buffer_maxlen = 0;
-    int longentry_maxlen = 255;
+    char name[PYLIBSSH2_SFTP_NAME_MAX];
     PyObject *buffer;
+    PyObject *stat;
     PyObject *dict = NULL;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->handle == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftpdir object has been closed/shutdown.");
@@ -117,38 +129,186 @@ PYLIBSSH2_Sftpdir_list_files(PYLIBSSH2_SFTPDIR *self, PyObject *args)
     }
 
     dict = PyDict_New();
+    if (dict == NULL) {
+        return NULL;
+    }
     while (1) {
-        buffer = PyString_FromStringAndSize(NULL, longentry_maxlen);
-        if (buffer == NULL) {
-            Py_INCREF(Py_None);
-            return Py_None;
-        }
-
+        start = stats_now();
         Py_BEGIN_ALLOW_THREADS
-        buffer_maxlen = libssh2_sftp_readdir(self->handle,
-            PyString_AsString(buffer), longentry_maxlen, &attrs);
+        buffer_maxlen = libssh2_sftp_readdir(self->handle, name, sizeof(name), &attrs);
+        end = stats_now();
         Py_END_ALLOW_THREADS
+        stats_record(&self->stats, self->session, PYLIBSSH2_OP_READDIR, NULL, start, end, buffer_maxlen,
+                         buffer_maxlen > 0 ? buffer_maxlen : 0, 0);
 
         if (buffer_maxlen == 0) {
             break;
-        } else if (buffer_maxlen == -1) {
+        } else if (buffer_maxlen == LIBSSH2_ERROR_EAGAIN) {
+            Py_DECREF(dict);
+            set_would_block(self->session, NULL);
+            return NULL;
+        } else if (buffer_maxlen < 0) {
+            Py_DECREF(dict);
             PyErr_SetString(PYLIBSSH2_Error, "Unable to listdir.");
             return NULL;
         }
 
-        if ( buffer_maxlen != longentry_maxlen &&
-             _PyString_Resize(&buffer, buffer_maxlen) < 0) {
-            Py_INCREF(Py_None);
-            return Py_None;
+        buffer = PyString_FromStringAndSize(name, buffer_maxlen);
+        stat = (PyObject *)PYLIBSSH2_SftpAttributes_New(&attrs);
+        if (buffer == NULL || stat == NULL || PyDict_SetItem(dict, buffer, stat) < 0) {
+            Py_XDECREF(buffer);
+            Py_XDECREF(stat);
+            Py_DECREF(dict);
+            return NULL;
         }
-
-        PyDict_SetItem(dict, buffer, sftp_attrs_to_statdict(&attrs));
+        Py_DECREF(buffer);
+        Py_DECREF(stat);
     }
 
     return dict;
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Sftpdir_read_batch
+ */
+static char PYLIBSSH2_Sftpdir_read_batch_doc[] = "\n\
+read_batch([batch]) -> list\n\
+\n\
+Reads up to batch entries with a single release of the GIL. The names\n\
+and attributes are gathered in a buffer kept by the object between\n\
+calls. In non-blocking mode a partial batch is returned when the\n\
+server has not answered yet.\n\
+\n\
+@param batch: maximum number of entries, 256 by default\n\
+@type batch: int\n\
+\n\
+@return: list of (name, SftpAttributes) tuples, empty at the end of the directory\n\
+@rtype: list\n\
+";
+
+static PyObject *
+PYLIBSSH2_Sftpdir_read_batch(PYLIBSSH2_SFTPDIR *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    int batch = PYLIBSSH2_SFTPDIR_BATCH;
+    int count = 0;
+    int rc = 0;
+    int nomem = 0;
+    int i;
+    size_t used = 0;
+    PYLIBSSH2_SFTPDIR_ENTRY *entries;
+    PyObject *list;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if (!PyArg_ParseTuple(args, "|i:read_batch", &batch)) {
+        return NULL;
+    }
+
+    if(self->handle == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftpdir object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (batch <= 0) {
+        PyErr_SetString(PyExc_ValueError, "batch must be positive");
+        return NULL;
+    }
+
+    if (self->entries_size < batch) {
+        entries = realloc(self->entries, batch * sizeof(PYLIBSSH2_SFTPDIR_ENTRY));
+        if (entries == NULL) {
+            return PyErr_NoMemory();
+        }
+        self->entries = entries;
+        self->entries_size = batch;
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    while (count < batch) {
+        /* every entry gets room for the longest name */
+        if (self->names_size - used < PYLIBSSH2_SFTP_NAME_MAX) {
+            size_t size = self->names_size ? self->names_size * 2 : 16 * PYLIBSSH2_SFTP_NAME_MAX;
+            char *names = realloc(self->names, size);
+            if (names == NULL) {
+                nomem = 1;
+                break;
+            }
+            self->names = names;
+            self->names_size = size;
+        }
+
+        rc = libssh2_sftp_readdir(self->handle, self->names + used,
+                                  PYLIBSSH2_SFTP_NAME_MAX, &self->entries[count].attrs);
+        if (rc <= 0) {
+            break;
+        }
+        self->entries[count].offset = used;
+        self->entries[count].length = rc;
+        used += rc;
+        count++;
+    }
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_READDIR, NULL, start, end, rc, used, 0);
+
+    if (nomem) {
+        return PyErr_NoMemory();
+    }
+
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        if (count == 0) {
+            set_would_block(self->session, NULL);
+            return NULL;
+        }
+    } else if (rc == LIBSSH2_ERROR_BUFFER_TOO_SMALL) {
+        PyErr_Format(PYLIBSSH2_Error, "Unable to readdir: entry name longer than %d bytes.",
+                     PYLIBSSH2_SFTP_NAME_MAX - 1);
+        return NULL;
+    } else if (rc < 0) {
+        PyErr_SetString(PYLIBSSH2_Error, "Unable to readdir.");
+        return NULL;
+    }
+
+    list = PyList_New(count);
+    if (list == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < count; i++) {
+        PyObject *entry = Py_BuildValue("(s#N)", self->names + self->entries[i].offset,
+                                        (int)self->entries[i].length,
+                                        (PyObject *)PYLIBSSH2_SftpAttributes_New(&self->entries[i].attrs));
+        if (entry == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, entry);
+    }
+
+    return list;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Sftpdir_stats
+ */
+static char PYLIBSSH2_Sftpdir_stats_doc[] = "\n\
+stats() -> dict\n\
+\n\
+Returns the counters of the libssh2 calls made on this Sftpdir object:\n\
+calls, bytes_read, bytes_written, eagain, errors and blocked_ns, the time\n\
+spent inside libssh2 in nanoseconds.\n\
+\n\
+@return counters since the object was created, and its id in the traces\n\
+@rtype  dict";
+
+static PyObject *
+PYLIBSSH2_Sftpdir_stats(PYLIBSSH2_SFTPDIR *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    return stats_to_dict(&self->stats);
+}
+/* }}} */
 
 /*
  * ADD_METHOD(name) expands to a correct PyMethodDef declaration
@@ -162,6 +322,8 @@ static PyMethodDef PYLIBSSH2_Sftpdir_methods[] =
 {
     ADD_METHOD(read),
     ADD_METHOD(list_files),
+    ADD_METHOD(read_batch),
+    ADD_METHOD(stats),
     { NULL, NULL }
 };
 #undef ADD_METHOD
@@ -184,6 +346,11 @@ PYLIBSSH2_Sftpdir_New(LIBSSH2_SESSION* session, LIBSSH2_SFTP* sftp, LIBSSH2_SFTP
     self->session = session;
     self->sftp = sftp;
     self->handle = handle;
+    stats_init(&self->stats);
+    self->names = NULL;
+    self->names_size = 0;
+    self->entries = NULL;
+    self->entries_size = 0;
 
     return self;
 }
@@ -193,11 +360,14 @@ PYLIBSSH2_Sftpdir_dealloc(PYLIBSSH2_SFTPDIR *self)
 {
     PRINTFUNCNAME
     if (self) {
+        free(self->names);
+        free(self->entries);
+        stats_clear(&self->stats);
         if(self->handle) {
             libssh2_sftp_close_handle(self->handle);
             self->handle = NULL;
-            PyObject_Del(self);
         }
+        PyObject_Del(self);
     }
 }
 
@@ -23,18 +23,35 @@
 
 #include <Python.h>
 #include <libssh2.h>
+#include "stats.h"
 
 extern int init_libssh2_Sftpdir(PyObject *);
 
 extern PyTypeObject PYLIBSSH2_Sftpdir_Type;
 
+/* longest entry name accepted, and default number of entries per batch */
+#define PYLIBSSH2_SFTP_NAME_MAX         4096
+#define PYLIBSSH2_SFTPDIR_BATCH         256
+
 #define PYLIBSSH2_Sftpdir_Check(v) ((v)->ob_type == &PYLIBSSH2_Sftpdir_Type)
 
+typedef struct {
+    size_t                   offset;
+    size_t                   length;
+    LIBSSH2_SFTP_ATTRIBUTES  attrs;
+} PYLIBSSH2_SFTPDIR_ENTRY;
+
 typedef struct {
     PyObject_HEAD
     LIBSSH2_SESSION      *session;
     LIBSSH2_SFTP         *sftp;
     LIBSSH2_SFTP_HANDLE  *handle;
+    /* reused by read_batch, grown on demand */
+    char                    *names;
+    size_t                   names_size;
+    PYLIBSSH2_SFTPDIR_ENTRY *entries;
+    int                      entries_size;
+    PYLIBSSH2_STATS          stats;
 } PYLIBSSH2_SFTPDIR;
 
 extern void PYLIBSSH2_Sftpdir_close(PYLIBSSH2_SFTPDIR *self);
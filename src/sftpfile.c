@@ -19,6 +19,8 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 #include <Python.h>
+#include <errno.h>
+#include <unistd.h>
 #define PYLIBSSH2_MODULE
 #include "pylibssh2.h"
 
@@ -54,6 +56,8 @@ PYLIBSSH2_Sftpfile_read(PYLIBSSH2_SFTPFILE *self, PyObject *args)
     int rc;
     int buffer_maxlen = 1024;
     PyObject *buffer;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->handle == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
@@ -70,9 +74,12 @@ PYLIBSSH2_Sftpfile_read(PYLIBSSH2_SFTPFILE *self, PyObject *args)
         return Py_None;
     }
 
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
     rc = libssh2_sftp_read(self->handle, PyString_AsString(buffer), buffer_maxlen);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_READ, NULL, start, end, rc, rc > 0 ? rc : 0, 0);
 
     if (rc >= 0) {
         if ( rc != buffer_maxlen && _PyString_Resize(&buffer, rc) < 0) {
@@ -83,52 +90,539 @@ PYLIBSSH2_Sftpfile_read(PYLIBSSH2_SFTPFILE *self, PyObject *args)
     }
 
     Py_XDECREF(buffer);
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        set_would_block(self->session, NULL);
+        return NULL;
+    }
     Py_INCREF(Py_None);
 
     return Py_None;
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Sftpfile_readinto
+ */
+static char PYLIBSSH2_Sftpfile_readinto_doc[] = "\n\
+readinto(buffer) -> int\n\
+\n\
+Reads at most len(buffer) bytes directly into buffer, which can be any\n\
+writable buffer object (bytearray, memoryview, mmap...).\n\
+\n\
+@param  buffer: storage for the bytes read\n\
+@type   buffer: writable buffer\n\
+\n\
+@return number of bytes read, 0 on end of file\n\
+@rtype  int";
+
+static PyObject *
+PYLIBSSH2_Sftpfile_readinto(PYLIBSSH2_SFTPFILE *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    ssize_t rc;
+    PyObject *obj;
+    Py_buffer view;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if(self->handle == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "O:readinto", &obj)) {
+        return NULL;
+    }
+
+    if (get_writable_buffer(obj, &view) < 0) {
+        return NULL;
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    rc = libssh2_sftp_read(self->handle, view.buf, view.len);
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_READ, NULL, start, end, rc, rc > 0 ? rc : 0, 0);
+
+    PyBuffer_Release(&view);
+
+    if (rc < 0) {
+        char *errmsg;
+        if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            errmsg = "";
+        }
+        switch (rc) {
+            case LIBSSH2_ERROR_SOCKET_TIMEOUT:
+                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SOCKET_TIMEOUT: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SFTP_PROTOCOL:
+                libssh2_sftp_errno_to_exception(libssh2_sftp_last_error(self->sftp));
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to read sftp %i: %s", (int)rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PyInt_FromSsize_t(rc);
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Sftpfile_read_pipelined
+ */
+static char PYLIBSSH2_Sftpfile_read_pipelined_doc[] = "\n\
+read_pipelined(total, [chunk, depth]) -> str\n\
+\n\
+Reads up to total bytes asking libssh2 for chunk * depth bytes at a\n\
+time, so that the transfer is not bound by one round trip per request.\n\
+libssh2 sends READ requests of at most 30000 bytes and reads ahead up to\n\
+four times the length asked, at most 8 MB: the defaults keep about 64\n\
+requests in flight, and a chunk above 30000 only widens the window. The\n\
+whole loop runs without the GIL.\n\
+\n\
+@param  total: maximum number of bytes to read\n\
+@type   total: int\n\
+@param  chunk: bytes per READ request, libssh2 caps it at 30000\n\
+@type   chunk: int\n\
+@param  depth: chunk * depth is the length asked of libssh2 at a time\n\
+@type   depth: int\n\
+\n\
+@return bytes read, shorter than total at end of file or when a read\n\
+        fails after some data arrived, the next call then reports it\n\
+@rtype  str";
+
+static PyObject *
+PYLIBSSH2_Sftpfile_read_pipelined(PYLIBSSH2_SFTPFILE *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    ssize_t rc = 0;
+    Py_ssize_t total;
+    Py_ssize_t got = 0;
+    Py_ssize_t window;
+    int chunk = PYLIBSSH2_SFTP_CHUNK_SIZE;
+    int depth = PYLIBSSH2_SFTP_PIPELINE_DEPTH;
+    char *cbuf;
+    PyObject *buffer;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if(self->handle == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "n|ii:read_pipelined", &total, &chunk, &depth)) {
+        return NULL;
+    }
+
+    if (total < 0 || chunk <= 0 || depth <= 0) {
+        PyErr_SetString(PyExc_ValueError, "total must be non-negative, chunk and depth positive");
+        return NULL;
+    }
+
+    buffer = PyString_FromStringAndSize(NULL, total);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    cbuf = PyString_AS_STRING(buffer);
+
+    /*
+     * libssh2 splits each read into READ requests of at most 30000 bytes
+     * and sends them, plus a read-ahead of up to four times the length,
+     * before waiting for the first reply: the length asked sets how much
+     * is in flight, not the number of requests.
+     */
+    window = (Py_ssize_t)chunk * depth;
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    while (got < total) {
+        rc = libssh2_sftp_read(self->handle, cbuf + got,
+                               (size_t)(total - got < window ? total - got : window));
+        if (rc <= 0) {
+            break;
+        }
+        got += rc;
+    }
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_TRANSFER, NULL, start, end, rc, got, 0);
+
+    /* the offset moved past the bytes read, they must not be dropped */
+    if (rc < 0 && got == 0) {
+        char *errmsg;
+        Py_DECREF(buffer);
+        if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            errmsg = "";
+        }
+        switch (rc) {
+            case LIBSSH2_ERROR_SOCKET_TIMEOUT:
+                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SOCKET_TIMEOUT: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SFTP_PROTOCOL:
+                libssh2_sftp_errno_to_exception(libssh2_sftp_last_error(self->sftp));
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to read sftp %i: %s", (int)rc, errmsg);
+                return NULL;
+        }
+    }
+
+    if (got != total && _PyString_Resize(&buffer, got) < 0) {
+        return NULL;
+    }
+
+    return buffer;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Sftpfile_copy_to
+ */
+static char PYLIBSSH2_Sftpfile_copy_to_doc[] = "\n\
+copy_to(dst, [chunk, depth]) -> long\n\
+\n\
+Copies this file from its current position to its end into the Sftpfile\n\
+dst, which may belong to another session. Reads and writes keep depth\n\
+requests of chunk bytes in flight, and the whole loop runs without the\n\
+GIL and without Python buffers.\n\
+\n\
+@param  dst: file opened for writing\n\
+@type   dst: Sftpfile\n\
+@param  chunk: size of each READ and WRITE request (capped by libssh2)\n\
+@type   chunk: int\n\
+@param  depth: number of requests kept outstanding\n\
+@type   depth: int\n\
+\n\
+@return number of bytes copied\n\
+@rtype  long";
+
+static PyObject *
+PYLIBSSH2_Sftpfile_copy_to(PYLIBSSH2_SFTPFILE *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    ssize_t rc = 0;
+    ssize_t got, sent;
+    unsigned PY_LONG_LONG copied = 0;
+    size_t window;
+    int chunk = PYLIBSSH2_SFTP_CHUNK_SIZE;
+    int depth = PYLIBSSH2_SFTP_PIPELINE_DEPTH;
+    char *cbuf;
+    char *errmsg;
+    PYLIBSSH2_SFTPFILE *dst;
+    PYLIBSSH2_SFTPFILE *failed = self;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if(self->handle == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "O!|ii:copy_to", &PYLIBSSH2_Sftpfile_Type, &dst, &chunk, &depth)) {
+        return NULL;
+    }
+
+    if(dst->handle == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (chunk <= 0 || depth <= 0) {
+        PyErr_SetString(PyExc_ValueError, "chunk and depth must be positive");
+        return NULL;
+    }
+
+    window = (size_t)chunk * depth;
+    cbuf = malloc(window);
+    if (cbuf == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    while (1) {
+        rc = libssh2_sftp_read(self->handle, cbuf, window);
+        if (rc <= 0) {
+            break;
+        }
+        got = rc;
+        sent = 0;
+        while (sent < got) {
+            rc = libssh2_sftp_write(dst->handle, cbuf + sent, got - sent);
+            if (rc < 0) {
+                failed = dst;
+                break;
+            }
+            sent += rc;
+        }
+        if (rc < 0) {
+            break;
+        }
+        copied += got;
+    }
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_TRANSFER, NULL, start, end,
+                 failed == self ? rc : 0, copied, 0);
+    if (dst->session == self->session) {
+        /* one session, one call: its totals only miss the bytes written */
+        stats_record(&dst->stats, NULL, PYLIBSSH2_OP_TRANSFER, NULL, start, end,
+                     failed == dst ? rc : 0, 0, copied);
+        stats_add_bytes(self->session, 0, copied);
+    } else {
+        stats_record(&dst->stats, dst->session, PYLIBSSH2_OP_TRANSFER, NULL, start, end,
+                     failed == dst ? rc : 0, 0, copied);
+    }
+
+    free(cbuf);
+
+    if (rc < 0) {
+        if (libssh2_session_last_error(failed->session, &errmsg, NULL, 0) != rc) {
+            errmsg = "";
+        }
+        switch (rc) {
+            case LIBSSH2_ERROR_SOCKET_TIMEOUT:
+                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SOCKET_TIMEOUT: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SFTP_PROTOCOL:
+                libssh2_sftp_errno_to_exception(libssh2_sftp_last_error(failed->sftp));
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(failed->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to copy sftp file %i: %s", (int)rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PyLong_FromUnsignedLongLong(copied);
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Sftpfile_write
  */
 static char PYLIBSSH2_Sftpfile_write_doc[] = "\n\
+write(buffer) -> int\n\
 \n\
-Arguments:\n\
+Writes the content of any readable buffer object without copying it.\n\
 \n\
-Returns:\n\
-";
+@param  buffer: bytes to write (str, memoryview, mmap...)\n\
+@type   buffer: buffer\n\
+\n\
+@return number of bytes written\n\
+@rtype  int";
 
 static PyObject *
 PYLIBSSH2_Sftpfile_write(PYLIBSSH2_SFTPFILE *self, PyObject *args)
 {
     PRINTFUNCNAME
-    int rc, buffer_len;
-    char *buffer;
+    ssize_t rc;
+    PyObject *obj;
+    Py_buffer view;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
 
     if(self->handle == NULL) {
         PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
         return NULL;
     }
 
-    if (!PyArg_ParseTuple(args, "s#:write", &buffer, &buffer_len)) {
+    if (!PyArg_ParseTuple(args, "O:write", &obj)) {
         return NULL;
     }
 
+    /* any readable buffer is sent as is: str, memoryview slice, mmap... */
+    if (get_readable_buffer(obj, &view) < 0) {
+        return NULL;
+    }
+
+    start = stats_now();
     Py_BEGIN_ALLOW_THREADS
-    rc = libssh2_sftp_write(self->handle, buffer, buffer_len);
+    rc = libssh2_sftp_write(self->handle, view.buf, view.len);
+    end = stats_now();
     Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_WRITE, NULL, start, end, rc, 0, rc > 0 ? rc : 0);
 
+    PyBuffer_Release(&view);
+
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        set_would_block(self->session, NULL);
+        return NULL;
+    }
     if (rc < 0) {
         /* CLEAN: PYLIBSSH2_Sftpfile_CANT_WRITE_MSG */
         PyErr_Format(PYLIBSSH2_Error, "Unable to write sftp.");
         return NULL;
     }
 
-    return Py_BuildValue("i", rc);
+    return Py_BuildValue("n", rc);
 
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Sftpfile_write_pipelined
+ */
+static char PYLIBSSH2_Sftpfile_write_pipelined_doc[] = "\n\
+write_pipelined(fd, [chunk, depth]) -> long\n\
+\n\
+Uploads the local file descriptor fd from its current position to its end,\n\
+keeping depth WRITE requests of chunk bytes in flight. If the server fails\n\
+a pipelined write, the upload restarts at the last acknowledged offset with\n\
+one request at a time. The whole loop runs without the GIL, and on return\n\
+fd is positioned just after the last acknowledged byte.\n\
+\n\
+@param  fd: seekable local file descriptor to read from\n\
+@type   fd: int\n\
+@param  chunk: size of each WRITE request (capped by libssh2)\n\
+@type   chunk: int\n\
+@param  depth: number of WRITE requests kept outstanding\n\
+@type   depth: int\n\
+\n\
+@return number of bytes acknowledged by the server\n\
+@rtype  long";
+
+static PyObject *
+PYLIBSSH2_Sftpfile_write_pipelined(PYLIBSSH2_SFTPFILE *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    ssize_t rc = 0;
+    ssize_t len = 0;
+    ssize_t sent;
+    int fd;
+    int chunk = PYLIBSSH2_SFTP_CHUNK_SIZE;
+    int depth = PYLIBSSH2_SFTP_PIPELINE_DEPTH;
+    int read_errno = 0;
+    size_t window;
+    off_t local_base;
+    libssh2_uint64_t remote_base;
+    libssh2_uint64_t acked = 0;
+    char *cbuf;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if(self->handle == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "i|ii:write_pipelined", &fd, &chunk, &depth)) {
+        return NULL;
+    }
+
+    if (chunk <= 0 || depth <= 0) {
+        PyErr_SetString(PyExc_ValueError, "chunk and depth must be positive");
+        return NULL;
+    }
+
+    local_base = lseek(fd, 0, SEEK_CUR);
+    if (local_base == (off_t)-1) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    window = (size_t)chunk * depth;
+    cbuf = PyMem_Malloc(window);
+    if (cbuf == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    remote_base = libssh2_sftp_tell64(self->handle);
+    for (;;) {
+        len = pread(fd, cbuf, window, local_base + acked);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            read_errno = errno;
+            break;
+        }
+        if (len == 0) {
+            break;
+        }
+
+        /*
+         * libssh2 splits the buffer into WRITE requests, sends all of them,
+         * then collects the acknowledgements: a window of chunk * depth
+         * bytes keeps depth requests outstanding.
+         */
+        for (sent = 0; sent < len; sent += rc) {
+            rc = libssh2_sftp_write(self->handle, cbuf + sent, len - sent);
+            if (rc <= 0) {
+                break;
+            }
+            acked += rc;
+        }
+
+        if (rc == 0) {
+            break;
+        }
+        if (rc < 0) {
+            if (rc == LIBSSH2_ERROR_EAGAIN || window == (size_t)chunk) {
+                break;
+            }
+            /* server refused a pipelined write, go on one request at a time */
+            window = chunk;
+            rc = 0;
+            libssh2_sftp_seek64(self->handle, remote_base + acked);
+        }
+    }
+    lseek(fd, local_base + acked, SEEK_SET);
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_TRANSFER, NULL, start, end, rc, 0, acked);
+
+    PyMem_Free(cbuf);
+
+    if (read_errno != 0) {
+        errno = read_errno;
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    if (rc < 0) {
+        char *errmsg;
+        if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            errmsg = "";
+        }
+        switch (rc) {
+            case LIBSSH2_ERROR_SOCKET_TIMEOUT:
+                PyErr_Format(PYLIBSSH2_Error, "LIBSSH2_ERROR_SOCKET_TIMEOUT: %s", errmsg);
+                return NULL;
+
+            case LIBSSH2_ERROR_SFTP_PROTOCOL:
+                libssh2_sftp_errno_to_exception(libssh2_sftp_last_error(self->sftp));
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to write sftp %i: %s", (int)rc, errmsg);
+                return NULL;
+        }
+    }
+
+    return PyLong_FromUnsignedLongLong(acked);
+}
+/* }}} */
+
 /* {{{ PYLIBSSH2_Sftpfile_tell
  */
 static char PYLIBSSH2_Sftpfile_tell_doc[] = "\n\
@@ -183,6 +677,92 @@ PYLIBSSH2_Sftpfile_seek(PYLIBSSH2_SFTPFILE *self, PyObject *args)
 }
 /* }}} */
 
+/* {{{ PYLIBSSH2_Sftpfile_truncate
+ */
+static char PYLIBSSH2_Sftpfile_truncate_doc[] = "\n\
+truncate(size)\n\
+\n\
+Sets the size of the remote file, cutting or zero extending it.\n\
+\n\
+@param  size: new size of the file\n\
+@type   size: long\n\
+";
+
+static PyObject*
+PYLIBSSH2_Sftpfile_truncate(PYLIBSSH2_SFTPFILE *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    unsigned PY_LONG_LONG size;
+    LIBSSH2_SFTP_ATTRIBUTES attr;
+    char *errmsg;
+    int rc;
+    unsigned PY_LONG_LONG start;
+    unsigned PY_LONG_LONG end;
+
+    if(self->handle == NULL) {
+        PyErr_Format(PYLIBSSH2_Error, "Sftpfile object has been closed/shutdown.");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "K:truncate", &size)) {
+        return NULL;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.flags = LIBSSH2_SFTP_ATTR_SIZE;
+    attr.filesize = size;
+
+    start = stats_now();
+    Py_BEGIN_ALLOW_THREADS
+    rc = libssh2_sftp_fsetstat(self->handle, &attr);
+    end = stats_now();
+    Py_END_ALLOW_THREADS
+    stats_record(&self->stats, self->session, PYLIBSSH2_OP_METADATA, NULL, start, end, rc, 0, 0);
+
+    if (rc < 0) {
+        if (libssh2_session_last_error(self->session, &errmsg, NULL, 0) != rc) {
+            errmsg = "";
+        }
+        switch (rc) {
+            case LIBSSH2_ERROR_SFTP_PROTOCOL:
+                libssh2_sftp_errno_to_exception(libssh2_sftp_last_error(self->sftp));
+                return NULL;
+
+            case LIBSSH2_ERROR_EAGAIN:
+                set_would_block(self->session, errmsg);
+                return NULL;
+
+            default:
+                PyErr_Format(PYLIBSSH2_Error, "Unable to truncate sftp file %i: %s", rc, errmsg);
+                return NULL;
+        }
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Sftpfile_stats
+ */
+static char PYLIBSSH2_Sftpfile_stats_doc[] = "\n\
+stats() -> dict\n\
+\n\
+Returns the counters of the libssh2 calls made on this Sftpfile object:\n\
+calls, bytes_read, bytes_written, eagain, errors and blocked_ns, the time\n\
+spent inside libssh2 in nanoseconds.\n\
+\n\
+@return counters since the object was created, and its id in the traces\n\
+@rtype  dict";
+
+static PyObject *
+PYLIBSSH2_Sftpfile_stats(PYLIBSSH2_SFTPFILE *self, PyObject *args)
+{
+    PRINTFUNCNAME
+    return stats_to_dict(&self->stats);
+}
+/* }}} */
+
 /*
  * ADD_METHOD(name) expands to a correct PyMethodDef declaration
  *   {  'name', (PyCFunction)PYLIBSSH2_Sftpfile_name, METH_VARARGS }
@@ -194,9 +774,15 @@ PYLIBSSH2_Sftpfile_seek(PYLIBSSH2_SFTPFILE *self, PyObject *args)
 static PyMethodDef PYLIBSSH2_Sftpfile_methods[] =
 {
     ADD_METHOD(read),
+    ADD_METHOD(readinto),
+    ADD_METHOD(read_pipelined),
     ADD_METHOD(write),
+    ADD_METHOD(write_pipelined),
+    ADD_METHOD(copy_to),
     ADD_METHOD(tell),
     ADD_METHOD(seek),
+    ADD_METHOD(truncate),
+    ADD_METHOD(stats),
     { NULL, NULL }
 };
 #undef ADD_METHOD
@@ -219,6 +805,7 @@ PYLIBSSH2_Sftpfile_New(LIBSSH2_SESSION * session, LIBSSH2_SFTP * sftp, LIBSSH2_S
     self->session = session;
     self->sftp = sftp;
     self->handle = handle;
+    stats_init(&self->stats);
 
     return self;
 }
@@ -228,6 +815,7 @@ PYLIBSSH2_Sftpfile_dealloc(PYLIBSSH2_SFTPFILE *self)
 {
     PRINTFUNCNAME
     if (self) {
+        stats_clear(&self->stats);
         if(self->handle) {
             libssh2_sftp_close_handle(self->handle);
             self->handle = NULL;
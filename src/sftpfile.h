@@ -23,11 +23,16 @@
 
 #include <Python.h>
 #include <libssh2.h>
+#include "stats.h"
 
 extern int init_libssh2_Sftpfile(PyObject *);
 
 extern PyTypeObject PYLIBSSH2_Sftpfile_Type;
 
+/* largest READ request libssh2 sends, and default number kept in flight */
+#define PYLIBSSH2_SFTP_CHUNK_SIZE       30000
+#define PYLIBSSH2_SFTP_PIPELINE_DEPTH   16
+
 #define PYLIBSSH2_Sftpfile_Check(v) ((v)->ob_type == &PYLIBSSH2_Sftpfile_Type)
 
 typedef struct {
@@ -35,6 +40,7 @@ typedef struct {
     LIBSSH2_SESSION      *session;
     LIBSSH2_SFTP         *sftp;
     LIBSSH2_SFTP_HANDLE  *handle;
+    PYLIBSSH2_STATS      stats;
 } PYLIBSSH2_SFTPFILE;
 
 extern void PYLIBSSH2_Sftpfile_close(PYLIBSSH2_SFTPFILE *self);
@@ -0,0 +1,264 @@
+/*-
+ * pylibssh2 - python bindings for libssh2 library
+ *
+ * Copyright (C) 2010 Wallix Inc.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <Python.h>
+#define PYLIBSSH2_MODULE
+#include "pylibssh2.h"
+
+int stats_histograms_enabled = 0;
+
+static PYLIBSSH2_HISTOGRAM stats_histograms[PYLIBSSH2_OP_COUNT];
+
+static unsigned PY_LONG_LONG stats_last_id = 0;
+
+const char *stats_op_names[PYLIBSSH2_OP_COUNT] = {
+    "startup",
+    "auth",
+    "open_session",
+    "sftp_init",
+    "sftp_open",
+    "read",
+    "write",
+    "stat",
+    "readdir",
+    "metadata",
+    "exec",
+    "transfer",
+};
+
+/* {{{ histogram_index
+ */
+static int
+histogram_index(unsigned PY_LONG_LONG value)
+{
+    int exponent;
+
+    if (value < PYLIBSSH2_HIST_SUB_COUNT) {
+        return (int)value;
+    }
+    exponent = 63 - __builtin_clzll(value);
+    return (exponent - PYLIBSSH2_HIST_SUB_BITS + 1) * PYLIBSSH2_HIST_SUB_COUNT
+           + (int)((value >> (exponent - PYLIBSSH2_HIST_SUB_BITS)) & (PYLIBSSH2_HIST_SUB_COUNT - 1));
+}
+/* }}} */
+
+/* {{{ histogram_lower
+ */
+static unsigned PY_LONG_LONG
+histogram_lower(int index, unsigned PY_LONG_LONG *width)
+{
+    int shift;
+
+    if (index < PYLIBSSH2_HIST_SUB_COUNT) {
+        *width = 1;
+        return index;
+    }
+    shift = index / PYLIBSSH2_HIST_SUB_COUNT - 1;
+    *width = 1ULL << shift;
+    return (unsigned PY_LONG_LONG)(PYLIBSSH2_HIST_SUB_COUNT + index % PYLIBSSH2_HIST_SUB_COUNT) << shift;
+}
+/* }}} */
+
+static void
+stats_add(PYLIBSSH2_STATS *stats, unsigned PY_LONG_LONG elapsed, long rc,
+          unsigned PY_LONG_LONG bytes_read, unsigned PY_LONG_LONG bytes_written)
+{
+    stats->calls++;
+    stats->bytes_read += bytes_read;
+    stats->bytes_written += bytes_written;
+    stats->blocked_ns += elapsed;
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        stats->eagain++;
+    } else if (rc < 0) {
+        stats->errors++;
+    }
+}
+
+/* {{{ stats_init
+ */
+void
+stats_init(PYLIBSSH2_STATS *stats)
+{
+    memset(stats, 0, sizeof(PYLIBSSH2_STATS));
+    stats->id = ++stats_last_id;
+}
+/* }}} */
+
+/* {{{ stats_set_path
+ */
+void
+stats_set_path(PYLIBSSH2_STATS *stats, const char *path)
+{
+    free(stats->path);
+    stats->path = strdup(path);
+}
+/* }}} */
+
+/* {{{ stats_clear
+ */
+void
+stats_clear(PYLIBSSH2_STATS *stats)
+{
+    free(stats->path);
+    stats->path = NULL;
+}
+/* }}} */
+
+/* {{{ stats_record
+ */
+void
+stats_record(PYLIBSSH2_STATS *stats, LIBSSH2_SESSION *session, int op,
+             const char *path, unsigned PY_LONG_LONG start,
+             unsigned PY_LONG_LONG end, long rc,
+             unsigned PY_LONG_LONG bytes_read,
+             unsigned PY_LONG_LONG bytes_written)
+{
+    unsigned PY_LONG_LONG elapsed = end - start;
+    PYLIBSSH2_SESSION *owner = NULL;
+
+    if (stats != NULL) {
+        stats_add(stats, elapsed, rc, bytes_read, bytes_written);
+    }
+    if (session != NULL) {
+        owner = *libssh2_session_abstract(session);
+    }
+    if (owner != NULL && &owner->stats != stats) {
+        stats_add(&owner->stats, elapsed, rc, bytes_read, bytes_written);
+    }
+
+    /* a call that would block returned at once, it says nothing of latency */
+    if (stats_histograms_enabled && rc != LIBSSH2_ERROR_EAGAIN) {
+        PYLIBSSH2_HISTOGRAM *histogram = &stats_histograms[op];
+
+        if (histogram->count == 0 || elapsed < histogram->min_ns) {
+            histogram->min_ns = elapsed;
+        }
+        if (elapsed > histogram->max_ns) {
+            histogram->max_ns = elapsed;
+        }
+        histogram->count++;
+        histogram->sum_ns += elapsed;
+        histogram->buckets[histogram_index(elapsed)]++;
+    }
+
+    if (trace_enabled) {
+        if (path == NULL && stats != NULL) {
+            path = stats->path;
+        }
+        trace_record(op, path, stats != NULL ? stats->id : (owner != NULL ? owner->stats.id : 0),
+                     owner != NULL ? owner->stats.id : 0, start, end, rc,
+                     bytes_read, bytes_written);
+    }
+}
+/* }}} */
+
+/* {{{ stats_add_bytes
+ */
+void
+stats_add_bytes(LIBSSH2_SESSION *session, unsigned PY_LONG_LONG bytes_read,
+                unsigned PY_LONG_LONG bytes_written)
+{
+    PYLIBSSH2_SESSION *owner = *libssh2_session_abstract(session);
+
+    if (owner != NULL) {
+        owner->stats.bytes_read += bytes_read;
+        owner->stats.bytes_written += bytes_written;
+    }
+}
+/* }}} */
+
+/* {{{ stats_to_dict
+ */
+PyObject *
+stats_to_dict(PYLIBSSH2_STATS *stats)
+{
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:K}",
+                         "id", stats->id,
+                         "calls", stats->calls,
+                         "bytes_read", stats->bytes_read,
+                         "bytes_written", stats->bytes_written,
+                         "eagain", stats->eagain,
+                         "errors", stats->errors,
+                         "blocked_ns", stats->blocked_ns);
+}
+/* }}} */
+
+/* {{{ stats_histograms_to_dict
+ */
+PyObject *
+stats_histograms_to_dict(void)
+{
+    PyObject *dict;
+    PyObject *buckets;
+    PyObject *item;
+    unsigned PY_LONG_LONG lower, width;
+    int op, i;
+
+    dict = PyDict_New();
+    if (dict == NULL) {
+        return NULL;
+    }
+    for (op = 0; op < PYLIBSSH2_OP_COUNT; op++) {
+        PYLIBSSH2_HISTOGRAM *histogram = &stats_histograms[op];
+
+        buckets = PyList_New(0);
+        if (buckets == NULL) {
+            goto error;
+        }
+        for (i = 0; i < PYLIBSSH2_HIST_BUCKETS; i++) {
+            if (histogram->buckets[i] == 0) {
+                continue;
+            }
+            lower = histogram_lower(i, &width);
+            item = Py_BuildValue("(KKK)", lower, lower + (width - 1), histogram->buckets[i]);
+            if (item == NULL || PyList_Append(buckets, item) < 0) {
+                Py_XDECREF(item);
+                Py_DECREF(buckets);
+                goto error;
+            }
+            Py_DECREF(item);
+        }
+        item = Py_BuildValue("{s:K,s:K,s:K,s:K,s:N}",
+                             "count", histogram->count,
+                             "sum_ns", histogram->sum_ns,
+                             "min_ns", histogram->min_ns,
+                             "max_ns", histogram->max_ns,
+                             "buckets", buckets);
+        if (item == NULL || PyDict_SetItemString(dict, stats_op_names[op], item) < 0) {
+            Py_XDECREF(item);
+            goto error;
+        }
+        Py_DECREF(item);
+    }
+    return dict;
+
+error:
+    Py_DECREF(dict);
+    return NULL;
+}
+/* }}} */
+
+/* {{{ stats_histograms_reset
+ */
+void
+stats_histograms_reset(void)
+{
+    memset(stats_histograms, 0, sizeof(stats_histograms));
+}
+/* }}} */
@@ -0,0 +1,134 @@
+/*-
+ * pylibssh2 - python bindings for libssh2 library
+ *
+ * Copyright (C) 2010 Wallix Inc.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _PYLIBSSH2_STATS_H_
+#define _PYLIBSSH2_STATS_H_
+
+#include <Python.h>
+#include <time.h>
+#include <libssh2.h>
+
+/*
+ * Counters kept by sessions, channels, SFTP channels and SFTP handles.
+ * They are only updated with the GIL held, after the libssh2 call.
+ */
+typedef struct {
+    /* unique in the process, identifies the object in the traces */
+    unsigned PY_LONG_LONG id;
+    /* remote path of SFTP files and directories, NULL otherwise */
+    char *path;
+    unsigned PY_LONG_LONG calls;
+    unsigned PY_LONG_LONG bytes_read;
+    unsigned PY_LONG_LONG bytes_written;
+    unsigned PY_LONG_LONG eagain;
+    unsigned PY_LONG_LONG errors;
+    /* time spent inside libssh2, in nanoseconds */
+    unsigned PY_LONG_LONG blocked_ns;
+} PYLIBSSH2_STATS;
+
+/*
+ * Operations with a latency histogram. Keep stats_op_names in stats.c in
+ * the same order.
+ */
+enum {
+    PYLIBSSH2_OP_STARTUP,
+    PYLIBSSH2_OP_AUTH,
+    PYLIBSSH2_OP_OPEN_SESSION,
+    PYLIBSSH2_OP_SFTP_INIT,
+    PYLIBSSH2_OP_SFTP_OPEN,
+    PYLIBSSH2_OP_READ,
+    PYLIBSSH2_OP_WRITE,
+    PYLIBSSH2_OP_STAT,
+    PYLIBSSH2_OP_READDIR,
+    PYLIBSSH2_OP_METADATA,
+    PYLIBSSH2_OP_EXEC,
+    /* a whole pipelined or SCP transfer, kept apart from the single calls */
+    PYLIBSSH2_OP_TRANSFER,
+    PYLIBSSH2_OP_COUNT
+};
+
+/*
+ * Log-linear histogram of call durations in nanoseconds: every power of two
+ * is split in 2^PYLIBSSH2_HIST_SUB_BITS buckets, so a bucket is at most
+ * 1/16th wider than its lower bound whatever the magnitude.
+ */
+#define PYLIBSSH2_HIST_SUB_BITS 4
+#define PYLIBSSH2_HIST_SUB_COUNT (1 << PYLIBSSH2_HIST_SUB_BITS)
+#define PYLIBSSH2_HIST_BUCKETS ((64 - PYLIBSSH2_HIST_SUB_BITS + 1) * PYLIBSSH2_HIST_SUB_COUNT)
+
+typedef struct {
+    unsigned PY_LONG_LONG count;
+    unsigned PY_LONG_LONG sum_ns;
+    unsigned PY_LONG_LONG min_ns;
+    unsigned PY_LONG_LONG max_ns;
+    unsigned PY_LONG_LONG buckets[PYLIBSSH2_HIST_BUCKETS];
+} PYLIBSSH2_HISTOGRAM;
+
+/* names of the operations, indexed by PYLIBSSH2_OP_* */
+extern const char *stats_op_names[PYLIBSSH2_OP_COUNT];
+
+/* histograms are only filled while this is set, see histograms_enable() */
+extern int stats_histograms_enabled;
+
+/* monotonic clock in nanoseconds */
+static inline unsigned PY_LONG_LONG
+stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned PY_LONG_LONG)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* zeroes the counters and gives stats a new id */
+void stats_init(PYLIBSSH2_STATS *stats);
+
+/* keeps a copy of path for the traces of the object */
+void stats_set_path(PYLIBSSH2_STATS *stats, const char *path);
+
+void stats_clear(PYLIBSSH2_STATS *stats);
+
+/*
+ * Account one call of kind op on path from start to end (from stats_now)
+ * that returned rc, in stats when not NULL, in the totals of the session
+ * owning session, in the histogram of op and in the traces. A NULL path
+ * stands for the path of stats. end is taken before the GIL is acquired
+ * again, waiting for it is not time spent in libssh2.
+ */
+void stats_record(PYLIBSSH2_STATS *stats, LIBSSH2_SESSION *session, int op,
+                  const char *path, unsigned PY_LONG_LONG start,
+                  unsigned PY_LONG_LONG end, long rc,
+                  unsigned PY_LONG_LONG bytes_read,
+                  unsigned PY_LONG_LONG bytes_written);
+
+/*
+ * Adds bytes to the totals of the session owning session, for a call
+ * already recorded there with other counts.
+ */
+void stats_add_bytes(LIBSSH2_SESSION *session, unsigned PY_LONG_LONG bytes_read,
+                     unsigned PY_LONG_LONG bytes_written);
+
+PyObject *stats_to_dict(PYLIBSSH2_STATS *stats);
+
+/* {op name: histogram dict} of every operation */
+PyObject *stats_histograms_to_dict(void);
+
+void stats_histograms_reset(void);
+
+#endif /* _PYLIBSSH2_STATS_H_ */
@@ -0,0 +1,257 @@
+/*-
+ * pylibssh2 - python bindings for libssh2 library
+ *
+ * Copyright (C) 2010 Wallix Inc.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <Python.h>
+#define PYLIBSSH2_MODULE
+#include "pylibssh2.h"
+
+/*
+ * Events go through a ring of trace_capacity slots, a power of two. Every
+ * producer and consumer holds the GIL, which serializes them: the ring
+ * needs no lock of its own and recording an event is a copy into the next
+ * slot. The callbacks only run once batch events are pending.
+ */
+int trace_enabled = 0;
+unsigned PY_LONG_LONG trace_dropped = 0;
+
+static PYLIBSSH2_TRACE_EVENT *trace_ring = NULL;
+static unsigned long trace_capacity = 0;
+/* free running counters, the slot is the counter modulo the capacity */
+static unsigned long trace_head = 0;
+static unsigned long trace_tail = 0;
+static int trace_batch = PYLIBSSH2_TRACE_BATCH;
+static PyObject *trace_callback = NULL;
+static PYLIBSSH2_TRACE_CALLBACK trace_c_callback = NULL;
+static void *trace_c_arg = NULL;
+/* set while a callback runs, the events it causes wait for the next batch */
+static int trace_flushing = 0;
+
+/* {{{ trace_event_to_tuple
+ */
+static PyObject *
+trace_event_to_tuple(PYLIBSSH2_TRACE_EVENT *event)
+{
+    return Py_BuildValue("(sKKzKKlKK)",
+                         stats_op_names[event->op], event->id, event->session_id,
+                         event->path[0] ? event->path : NULL,
+                         event->start_ns, event->end_ns, event->rc,
+                         event->bytes_read, event->bytes_written);
+}
+/* }}} */
+
+/* {{{ trace_drain
+ */
+PyObject *
+trace_drain(void)
+{
+    PyObject *list;
+    PyObject *item;
+
+    list = PyList_New(0);
+    if (list == NULL) {
+        return NULL;
+    }
+    while (trace_tail != trace_head) {
+        item = trace_event_to_tuple(&trace_ring[trace_tail & (trace_capacity - 1)]);
+        if (item == NULL || PyList_Append(list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return NULL;
+        }
+        Py_DECREF(item);
+        trace_tail++;
+    }
+    return list;
+}
+/* }}} */
+
+/* {{{ trace_flush
+ */
+static void
+trace_flush(void)
+{
+    unsigned long head = trace_head;
+    unsigned long first;
+    unsigned long count;
+    /* the callback may stop the tracing while it runs */
+    PYLIBSSH2_TRACE_CALLBACK c_callback = trace_c_callback;
+    void *c_arg = trace_c_arg;
+    PyObject *callback = trace_callback;
+    PyObject *type, *value, *traceback;
+    PyObject *events;
+    PyObject *result;
+
+    if (trace_flushing || trace_tail == head) {
+        return;
+    }
+    trace_flushing = 1;
+
+    if (c_callback != NULL) {
+        /* at most two calls, when the pending events wrap around the ring */
+        while (trace_tail != head) {
+            first = trace_tail & (trace_capacity - 1);
+            count = head - trace_tail;
+            if (count > trace_capacity - first) {
+                count = trace_capacity - first;
+            }
+            c_callback(&trace_ring[first], (int)count, c_arg);
+            trace_tail += count;
+        }
+    } else if (callback != NULL) {
+        /* the caller may be about to raise, keep its exception aside */
+        PyErr_Fetch(&type, &value, &traceback);
+        Py_INCREF(callback);
+        events = trace_drain();
+        if (events != NULL) {
+            result = PyObject_CallFunctionObjArgs(callback, events, NULL);
+            Py_DECREF(events);
+            Py_XDECREF(result);
+        }
+        if (PyErr_Occurred()) {
+            PyErr_WriteUnraisable(callback);
+        }
+        Py_DECREF(callback);
+        PyErr_Restore(type, value, traceback);
+    }
+
+    trace_flushing = 0;
+}
+/* }}} */
+
+/* {{{ trace_record
+ */
+void
+trace_record(int op, const char *path, unsigned PY_LONG_LONG id,
+             unsigned PY_LONG_LONG session_id, unsigned PY_LONG_LONG start_ns,
+             unsigned PY_LONG_LONG end_ns, long rc,
+             unsigned PY_LONG_LONG bytes_read,
+             unsigned PY_LONG_LONG bytes_written)
+{
+    PYLIBSSH2_TRACE_EVENT *event;
+
+    if (trace_head - trace_tail >= trace_capacity) {
+        trace_dropped++;
+        return;
+    }
+
+    event = &trace_ring[trace_head & (trace_capacity - 1)];
+    event->op = op;
+    event->rc = rc;
+    event->id = id;
+    event->session_id = session_id;
+    event->start_ns = start_ns;
+    event->end_ns = end_ns;
+    event->bytes_read = bytes_read;
+    event->bytes_written = bytes_written;
+    if (path != NULL) {
+        strncpy(event->path, path, PYLIBSSH2_TRACE_PATH_MAX - 1);
+        event->path[PYLIBSSH2_TRACE_PATH_MAX - 1] = '\0';
+    } else {
+        event->path[0] = '\0';
+    }
+    trace_head++;
+
+    if (trace_head - trace_tail >= (unsigned long)trace_batch) {
+        trace_flush();
+    }
+}
+/* }}} */
+
+/* {{{ trace_start
+ */
+int
+trace_start(PyObject *callback, int batch, int capacity)
+{
+    unsigned long size = 1;
+    PYLIBSSH2_TRACE_EVENT *ring;
+
+    if (trace_flushing) {
+        PyErr_SetString(PYLIBSSH2_Error, "Tracing cannot be changed from a trace callback.");
+        return -1;
+    }
+    if (batch <= 0 || capacity <= 0) {
+        PyErr_SetString(PyExc_ValueError, "batch and capacity must be positive");
+        return -1;
+    }
+
+    while (size < (unsigned long)capacity) {
+        size <<= 1;
+    }
+    if (size != trace_capacity) {
+        /* the pending events go to the previous callback, if any */
+        trace_flush();
+        ring = malloc(size * sizeof(PYLIBSSH2_TRACE_EVENT));
+        if (ring == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        trace_dropped += trace_head - trace_tail;
+        free(trace_ring);
+        trace_ring = ring;
+        trace_capacity = size;
+        trace_head = 0;
+        trace_tail = 0;
+    }
+
+    if (callback == Py_None) {
+        callback = NULL;
+    }
+    Py_XINCREF(callback);
+    Py_XDECREF(trace_callback);
+    trace_callback = callback;
+    trace_c_callback = NULL;
+    trace_c_arg = NULL;
+    trace_batch = (unsigned long)batch < size ? batch : (int)size;
+    trace_enabled = 1;
+
+    return 0;
+}
+/* }}} */
+
+/* {{{ trace_stop
+ */
+void
+trace_stop(void)
+{
+    trace_flush();
+    trace_enabled = 0;
+    Py_CLEAR(trace_callback);
+    trace_c_callback = NULL;
+    trace_c_arg = NULL;
+}
+/* }}} */
+
+/* {{{ PYLIBSSH2_Trace_SetCallback
+ */
+int
+PYLIBSSH2_Trace_SetCallback(PYLIBSSH2_TRACE_CALLBACK callback, void *arg, int batch)
+{
+    if (callback == NULL) {
+        trace_stop();
+        return 0;
+    }
+    if (trace_start(NULL, batch, trace_capacity ? trace_capacity : PYLIBSSH2_TRACE_CAPACITY) < 0) {
+        return -1;
+    }
+    trace_c_callback = callback;
+    trace_c_arg = arg;
+
+    return 0;
+}
+/* }}} */
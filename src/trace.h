@@ -0,0 +1,81 @@
+/*-
+ * pylibssh2 - python bindings for libssh2 library
+ *
+ * Copyright (C) 2010 Wallix Inc.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _PYLIBSSH2_TRACE_H_
+#define _PYLIBSSH2_TRACE_H_
+
+#include <Python.h>
+
+/* longer paths are truncated in the events */
+#define PYLIBSSH2_TRACE_PATH_MAX    256
+#define PYLIBSSH2_TRACE_CAPACITY    4096
+#define PYLIBSSH2_TRACE_BATCH       256
+
+/* one finished call, from start_ns to end_ns on the stats_now() clock */
+typedef struct {
+    int op;
+    long rc;
+    /* stats id of the object and of its session, 0 when unknown */
+    unsigned PY_LONG_LONG id;
+    unsigned PY_LONG_LONG session_id;
+    unsigned PY_LONG_LONG start_ns;
+    unsigned PY_LONG_LONG end_ns;
+    unsigned PY_LONG_LONG bytes_read;
+    unsigned PY_LONG_LONG bytes_written;
+    char path[PYLIBSSH2_TRACE_PATH_MAX];
+} PYLIBSSH2_TRACE_EVENT;
+
+/*
+ * Receives the events in order, count at a time, with the GIL held. The
+ * events are only valid during the call.
+ */
+typedef void (*PYLIBSSH2_TRACE_CALLBACK)(const PYLIBSSH2_TRACE_EVENT *events, int count, void *arg);
+
+/* events are only recorded while this is set */
+extern int trace_enabled;
+
+void trace_record(int op, const char *path, unsigned PY_LONG_LONG id,
+                  unsigned PY_LONG_LONG session_id, unsigned PY_LONG_LONG start_ns,
+                  unsigned PY_LONG_LONG end_ns, long rc,
+                  unsigned PY_LONG_LONG bytes_read,
+                  unsigned PY_LONG_LONG bytes_written);
+
+/*
+ * Records events and hands them to callback every batch events, replacing
+ * any Python callback. A NULL callback stops the recording after handing
+ * over the pending events. Returns -1 if the ring cannot be allocated.
+ */
+int PYLIBSSH2_Trace_SetCallback(PYLIBSSH2_TRACE_CALLBACK callback, void *arg, int batch);
+
+/*
+ * Records events in a ring of capacity events, calling the Python callback
+ * with a list of batch events at a time when it is not None.
+ */
+int trace_start(PyObject *callback, int batch, int capacity);
+
+/* hands the pending events to the callback and stops recording */
+void trace_stop(void);
+
+/* removes the pending events from the ring, as a list of tuples */
+PyObject *trace_drain(void);
+
+/* events lost because the ring was full */
+extern unsigned PY_LONG_LONG trace_dropped;
+
+#endif /* _PYLIBSSH2_TRACE_H_ */
@@ -18,6 +18,7 @@
  * along with this library; if not, write to the Free Software Foundation, Inc.,
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
+#include <poll.h>
 #include "util.h"
 
 /* {{{ get_flags
@@ -47,3 +48,29 @@ get_flags(char *mode) {
     return f;
 }
 /* }}} */
+
+/* {{{ wait_socket
+ */
+int
+wait_socket(int fd, LIBSSH2_SESSION *session, int timeout)
+{
+    struct pollfd pfd;
+    int directions = libssh2_session_block_directions(session);
+
+    pfd.fd = fd;
+    pfd.events = 0;
+    pfd.revents = 0;
+    if (directions & LIBSSH2_SESSION_BLOCK_INBOUND) {
+        pfd.events |= POLLIN;
+    }
+    if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) {
+        pfd.events |= POLLOUT;
+    }
+    /* nothing reported means libssh2 waits for the peer */
+    if (pfd.events == 0) {
+        pfd.events = POLLIN;
+    }
+
+    return poll(&pfd, 1, timeout);
+}
+/* }}} */
@@ -29,4 +29,11 @@
  */
 unsigned long get_flags(char *mode);
 
+/*
+ * Wait until fd is ready in the directions libssh2 is blocked on, for at
+ * most timeout milliseconds (-1 waits forever). Returns the poll result.
+ * Does not touch the GIL.
+ */
+int wait_socket(int fd, LIBSSH2_SESSION *session, int timeout);
+
 #endif /* _PYLIBSSH2_UTIL_H_ */
@@ -0,0 +1,68 @@
+import libssh2
+import os
+import pwd
+import socket
+import time
+import unittest
+
+
+def sizeof_fmt(num):
+    for x in ['bytes', 'KB', 'MB', 'GB', 'TB']:
+        if num < 1024.0:
+            return "%3.1f %s" % (num, x)
+        num /= 1024.0
+
+
+class ChannelBenchmarkTest(unittest.TestCase):
+    """
+    Sweeps the window and packet sizes of open_session. Over loopback the
+    window hardly matters, point hostname at the far end of the link to
+    tune: a fixed window caps a read at window_size bytes per round trip.
+    """
+
+    WINDOW_SIZES = (256 * 1024, 2 * 1024 * 1024, 8 * 1024 * 1024, 32 * 1024 * 1024)
+    PACKET_SIZES = (8 * 1024, 16 * 1024, 32 * 1024)
+    SIZE = 64 * 1024 * 1024
+
+    def setUp(self):
+        self.username = pwd.getpwuid(os.getuid())[0]
+        self.hostname = "localhost"
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.connect((self.hostname, 22))
+        self.session = libssh2.Session()
+        self.session.startup(self.sock)
+        self.session.userauth_agent(self.username)
+        self.assertNotEqual(self.session.userauth_authenticated(), 0)
+
+    def do_read(self, window_size, packet_size):
+        channel = self.session.open_session(window_size=window_size, packet_size=packet_size)
+        buf = bytearray(1024 * 1024)
+        received = 0
+        start_time = time.time()
+        channel.execute("head -c %d /dev/zero" % ChannelBenchmarkTest.SIZE)
+        while True:
+            rc = channel.readinto(buf)
+            if rc == 0:
+                break
+            received += rc
+        end_time = time.time()
+        self.session.channel_close(channel)
+        self.assertEqual(received, ChannelBenchmarkTest.SIZE)
+        return received / (end_time - start_time)
+
+    def test_sweep(self):
+        results = []
+        for window_size in ChannelBenchmarkTest.WINDOW_SIZES:
+            for packet_size in ChannelBenchmarkTest.PACKET_SIZES:
+                speed = self.do_read(window_size, packet_size)
+                results.append((speed, window_size, packet_size))
+                print "window %s packet %s speed %s/sec" % (sizeof_fmt(window_size), sizeof_fmt(packet_size), sizeof_fmt(speed))
+        speed, window_size, packet_size = max(results)
+        print "best: open_session(window_size=%d, packet_size=%d) %s/sec" % (window_size, packet_size, sizeof_fmt(speed))
+
+    def tearDown(self):
+        self.session.close()
+        self.sock.close()
+
+if __name__ == '__main__':
+    unittest.main()
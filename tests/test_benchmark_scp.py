@@ -1,4 +1,5 @@
 
+from libssh2.transfer import TransferManager, DOWNLOAD
 import libssh2
 import os
 import pwd
@@ -62,13 +63,40 @@ class SCPBenchmarkTest(unittest.TestCase):
 
         print "%s Files of %s took %ssec speed %s/sec" % (count, sizeof_fmt(size), end_time - start_time, sizeof_fmt(count * size / (end_time - start_time)))
 
-    @staticmethod
-    def dl(arg_tuple):
-        session = arg_tuple[0]
-        src = arg_tuple[1]
-        dst = arg_tuple[2]
-        print "session %s src %s dst %s" % (session, src, dst)
-        session.scp_recv_file(src, dst)
+    def do_parallel_test(self, count, size, session_count=4):
+        self.create_files(count, size)
+        socks = []
+        sessions = []
+        for i in range(0, session_count):
+            sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            sock.connect((self.hostname, 22))
+            session = libssh2.Session()
+            session.startup(sock)
+            session.userauth_agent(self.username)
+            socks.append(sock)
+            sessions.append(session)
+
+        transfers = []
+        for i in range(0, count):
+            src = os.path.join(SCPBenchmarkTest.SRC_PATH, "%s" % (i))
+            dst = os.path.join(SCPBenchmarkTest.DST_PATH, "%s" % (i))
+            transfers.append((src, dst, size))
+        report = TransferManager(sessions, DOWNLOAD).run(transfers)
+        self.assertEqual(report.errors, [])
+        for src, dst, size in transfers:
+            self.assertEqual(os.stat(dst).st_size, size)
+
+        print "%s Files of %s over %s sessions: %s" % (count, sizeof_fmt(size), session_count, report)
+        for session in sessions:
+            session.close()
+        for sock in socks:
+            sock.close()
+
+    def test_parallel_100_1K(self):
+        self.do_parallel_test(100, 1024)
+
+    def test_parallel_100_1MB(self):
+        self.do_parallel_test(100, 1024 * 1024)
 
     #def test_100_1MB(self):
     #    self.do_test(10, 1024 * 1024)
@@ -0,0 +1,115 @@
+import libssh2
+import os
+import pwd
+import select
+import shutil
+import socket
+import threading
+import time
+import unittest
+
+
+def sizeof_fmt(num):
+    for x in ['bytes', 'KB', 'MB', 'GB', 'TB']:
+        if num < 1024.0:
+            return "%3.1f %s" % (num, x)
+        num /= 1024.0
+
+
+class DelayProxy(threading.Thread):
+    """
+    Forwards one TCP connection to (host, port) adding delay seconds of
+    latency in each direction, so a local sshd behaves like a WAN link.
+    """
+
+    def __init__(self, host, port, delay):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.host = host
+        self.port = port
+        self.delay = delay
+        self.listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listener.bind(("127.0.0.1", 0))
+        self.listener.listen(1)
+        self.address = self.listener.getsockname()
+        self.running = True
+
+    def run(self):
+        client, _ = self.listener.accept()
+        server = socket.create_connection((self.host, self.port))
+        # socket -> (peer, queue of (due_time, data))
+        pending = {client: (server, []), server: (client, [])}
+        while self.running:
+            now = time.time()
+            timeout = self.delay
+            for sock, (peer, queue) in pending.items():
+                while queue and queue[0][0] <= now:
+                    peer.sendall(queue.pop(0)[1])
+                if queue:
+                    timeout = min(timeout, queue[0][0] - now)
+            readable = select.select(pending.keys(), [], [], max(timeout, 0))[0]
+            for sock in readable:
+                data = sock.recv(65536)
+                if not data:
+                    self.running = False
+                    break
+                pending[sock][1].append((time.time() + self.delay, data))
+        client.close()
+        server.close()
+        self.listener.close()
+
+
+class SFTPBenchmarkTest(unittest.TestCase):
+
+    SRC_FILE = "/tmp/repo-sftp-src"
+    DST_FILE = "/tmp/repo-sftp-dst"
+    # one way latency in seconds
+    DELAY = 0.025
+    SIZE = 8 * 1024 * 1024
+
+    def setUp(self):
+        self.username = pwd.getpwuid(os.getuid())[0]
+        self.hostname = "localhost"
+        self.proxy = DelayProxy(self.hostname, 22, SFTPBenchmarkTest.DELAY)
+        self.proxy.start()
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.connect(self.proxy.address)
+        self.session = libssh2.Session()
+        self.session.startup(self.sock)
+        self.session.userauth_agent(self.username)
+        self.assertNotEqual(self.session.userauth_authenticated(), 0)
+        self.sftp = self.session.sftp_init()
+        with open(SFTPBenchmarkTest.SRC_FILE, "w+") as f:
+            f.write(os.urandom(SFTPBenchmarkTest.SIZE))
+
+    def do_test(self, depth):
+        try:
+            os.unlink(SFTPBenchmarkTest.DST_FILE)
+        except:
+            pass
+        start_time = time.time()
+        self.sftp.get(SFTPBenchmarkTest.SRC_FILE, SFTPBenchmarkTest.DST_FILE, pipeline_depth=depth)
+        end_time = time.time()
+        self.assertEquals(os.stat(SFTPBenchmarkTest.DST_FILE).st_size, SFTPBenchmarkTest.SIZE)
+
+        print "depth %s: %s took %ssec speed %s/sec" % (depth, sizeof_fmt(SFTPBenchmarkTest.SIZE), end_time - start_time, sizeof_fmt(SFTPBenchmarkTest.SIZE / (end_time - start_time)))
+
+    def test_pipeline_depth(self):
+        for depth in [1, 2, 4, 8, 16, 32]:
+            self.do_test(depth)
+        self.assertTrue(open(SFTPBenchmarkTest.SRC_FILE).read() == open(SFTPBenchmarkTest.DST_FILE).read())
+
+    def tearDown(self):
+        self.session.sftp_shutdown(self.sftp)
+        self.session.close()
+        self.sock.close()
+        self.proxy.running = False
+        try:
+            os.unlink(SFTPBenchmarkTest.SRC_FILE)
+            os.unlink(SFTPBenchmarkTest.DST_FILE)
+        except:
+            pass
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,101 @@
+"""
+Unit tests for Channel
+"""
+
+import libssh2
+import mmap
+import os
+import pwd
+import socket
+import unittest
+
+
+class ChannelTest(unittest.TestCase):
+    def setUp(self):
+        self.username = pwd.getpwuid(os.getuid())[0]
+        self.hostname = "localhost"
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.connect((self.hostname, 22))
+        self.session = libssh2.Session()
+        self.session.startup(self.sock)
+        self.session.userauth_agent(self.username)
+        self.assertNotEqual(self.session.userauth_authenticated(), 0)
+
+    def test_readinto(self):
+        channel = self.session.open_session()
+        channel.execute("echo -n 0123456789")
+        buf = bytearray(16)
+        view = memoryview(buf)
+        received = 0
+        while True:
+            rc = channel.readinto(view[received:])
+            if rc == 0:
+                break
+            received += rc
+        self.assertEqual(str(buf[:received]), "0123456789")
+        self.session.channel_close(channel)
+
+    def test_read_ex_into_mmap(self):
+        channel = self.session.open_session()
+        channel.execute("echo -n out; echo -n err 1>&2")
+        buf = mmap.mmap(-1, 4096)
+        rc = channel.read_ex_into(buf, 1)
+        self.assertEqual(buf[:rc], "err")
+        rc = channel.read_ex_into(buf, 0)
+        self.assertEqual(buf[:rc], "out")
+        buf.close()
+        self.session.channel_close(channel)
+
+    def test_stream(self):
+        channel = self.session.open_session()
+        channel.execute("for i in 1 2 3; do echo out$i; echo err$i 1>&2; sleep 0.1; done; "
+                        "head -c 1000000 /dev/zero; exit 4")
+        out = []
+        err = []
+        status = channel.stream(lambda data: out.append(data.tobytes()),
+                                lambda data: err.append(data.tobytes()), 4096)
+        self.assertEqual(status, 4)
+        self.assertEqual("".join(out), "out1\nout2\nout3\n" + "\0" * 1000000)
+        self.assertEqual("".join(err), "err1\nerr2\nerr3\n")
+        self.assertTrue(max(len(data) for data in out) <= 4096)
+        self.session.channel_close(channel)
+
+    def test_window_tuning(self):
+        # a window small enough to hold back even a loopback read
+        channel = self.session.open_session(64 * 1024 * 1024, 16384)
+        stats = channel.stats()
+        self.assertEqual(stats["window_max"], 64 * 1024 * 1024)
+        self.assertTrue(stats["rtt_ns"] > 0)
+        initial = stats["window_target"]
+        self.assertEqual(initial, 16384)
+        channel.execute("head -c 20000000 /dev/zero")
+        buf = bytearray(1024 * 1024)
+        received = 0
+        while True:
+            rc = channel.readinto(buf)
+            if rc == 0:
+                break
+            received += rc
+        self.assertEqual(received, 20000000)
+        stats = channel.stats()
+        self.assertTrue(initial < stats["window_target"] <= 64 * 1024 * 1024)
+        self.session.channel_close(channel)
+        # tuning is off by default
+        channel = self.session.open_session()
+        self.assertEqual(channel.stats()["window_max"], 0)
+        self.session.channel_close(channel)
+
+    def test_window_size(self):
+        channel = self.session.open_session(window_size=8 * 1024 * 1024, packet_size=16384)
+        self.assertEqual(channel.stats()["window"], 8 * 1024 * 1024)
+        channel.execute("head -c 5000000 /dev/zero")
+        self.assertEqual(len(channel.read(-1)), 5000000)
+        self.session.channel_close(channel)
+        self.assertRaises(ValueError, self.session.open_session, packet_size=65536)
+
+    def tearDown(self):
+        self.session.close()
+        self.sock.close()
+
+if __name__ == '__main__':
+    unittest.main()
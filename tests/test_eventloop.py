@@ -0,0 +1,75 @@
+"""
+Unit tests for EventLoop
+"""
+
+import libssh2
+import os
+import pwd
+import socket
+import unittest
+
+
+class EventLoopTest(unittest.TestCase):
+    def setUp(self):
+        self.username = pwd.getpwuid(os.getuid())[0]
+        self.hostname = "localhost"
+        self.socks = []
+        self.sessions = []
+        for i in range(0, 4):
+            sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            sock.connect((self.hostname, 22))
+            session = libssh2.Session()
+            session.startup(sock)
+            session.userauth_agent(self.username)
+            self.assertNotEqual(session.userauth_authenticated(), 0)
+            self.socks.append(sock)
+            self.sessions.append(session)
+
+    def test_would_block(self):
+        session = self.sessions[0]
+        channel = session.open_session()
+        channel.execute("sleep 1")
+        session.set_blocking(False)
+        try:
+            channel.read(1)
+            self.fail("read did not block")
+        except libssh2.WouldBlock, e:
+            self.assertTrue(e.args[1] & libssh2.SESSION_BLOCK_INBOUND)
+            self.assertEqual(e.args[1], session.block_directions())
+        session.set_blocking(True)
+        session.channel_close(channel)
+
+    def test_concurrent_sessions(self):
+        results = {}
+
+        def run(session, index):
+            channel = yield session.open_session
+            yield channel.execute, "sleep 1; echo -n %s" % (index)
+            output = ""
+            while True:
+                data = yield channel.read, 1024
+                if not data:
+                    break
+                output += str(data)
+            results[index] = output
+            yield session.channel_close, channel
+
+        loop = libssh2.EventLoop()
+        tasks = []
+        for index, session in enumerate(self.sessions):
+            session.set_blocking(False)
+            tasks.append(loop.spawn(session, run(session, index)))
+        self.assertTrue(loop.run(timeout=30))
+        for task in tasks:
+            task.get()
+        self.assertEqual(results, dict((i, str(i)) for i in range(0, len(self.sessions))))
+
+    def tearDown(self):
+        for session in self.sessions:
+            session.set_blocking(True)
+            session.close()
+        for sock in self.socks:
+            sock.close()
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,70 @@
+"""
+Unit tests for SessionPool
+"""
+
+from libssh2.pool import SessionPool, SessionPoolException
+import os
+import pwd
+import threading
+import time
+import unittest
+
+
+class SessionPoolTest(unittest.TestCase):
+    def setUp(self):
+        self.username = pwd.getpwuid(os.getuid())[0]
+        self.hostname = "localhost"
+        self.pool = SessionPool(max_per_host=2, keepalive_interval=1)
+
+    def test_reuse(self):
+        session1 = self.pool.acquire(self.hostname, self.username)
+        self.pool.release(session1)
+        session2 = self.pool.acquire(self.hostname, self.username)
+        self.assertTrue(session1 is session2)
+        self.pool.release(session2)
+
+    def test_broken_not_reused(self):
+        session1 = self.pool.acquire(self.hostname, self.username)
+        self.pool.release(session1, broken=True)
+        session2 = self.pool.acquire(self.hostname, self.username)
+        self.assertFalse(session1 is session2)
+        self.pool.release(session2)
+
+    def test_keepalive(self):
+        session1 = self.pool.acquire(self.hostname, self.username)
+        self.pool.release(session1)
+        time.sleep(2)
+        with self.pool.channel(self.hostname, self.username) as channel:
+            channel.execute("true")
+        with self.pool.session(self.hostname, self.username) as session2:
+            self.assertTrue(session1 is session2)
+
+    def test_sftp(self):
+        with self.pool.sftp(self.hostname, self.username) as sftp1:
+            self.assertTrue(sftp1.exists("/tmp"))
+        with self.pool.sftp(self.hostname, self.username) as sftp2:
+            self.assertTrue(sftp1 is sftp2)
+
+    def test_max_per_host(self):
+        session1 = self.pool.acquire(self.hostname, self.username)
+        session2 = self.pool.acquire(self.hostname, self.username)
+        self.assertRaises(SessionPoolException, self.pool.acquire,
+                          self.hostname, self.username, timeout=0.1)
+        threading.Timer(0.2, self.pool.release, (session1,)).start()
+        session3 = self.pool.acquire(self.hostname, self.username, timeout=5)
+        self.assertTrue(session3 is session1)
+        self.pool.release(session2)
+        self.pool.release(session3)
+
+    def test_key_per_credential(self):
+        key = self.pool._key(self.hostname, 22, self.username, None, None, "secret")
+        self.assertNotEqual(key, self.pool._key(self.hostname, 22, self.username, None, None, "wrong"))
+        self.assertFalse("secret" in repr(key))
+        key = self.pool._key(self.hostname, 22, self.username, "~/.ssh/id_rsa", "a", None)
+        self.assertNotEqual(key, self.pool._key(self.hostname, 22, self.username, "~/.ssh/id_rsa", "b", None))
+
+    def tearDown(self):
+        self.pool.close()
+
+if __name__ == '__main__':
+    unittest.main()
@@ -65,6 +65,28 @@ class SCPTest(unittest.TestCase):
         if os.path.exists(IN_FILE_PATH):
             os.remove(IN_FILE_PATH)
 
+    def test_send_fd(self):
+        IN_FILE_PATH = "/tmp/test_scp_send_fd_in"
+        OUT_FILE_PATH = "/tmp/test_scp_send_fd_out"
+        FILE_CONTENT = os.urandom(1024 * 1024 + 1)
+        if os.path.exists(OUT_FILE_PATH):
+            os.remove(OUT_FILE_PATH)
+        f = open(IN_FILE_PATH, "w")
+        f.write(FILE_CONTENT)
+        f.close()
+        fd = os.open(IN_FILE_PATH, os.O_RDONLY)
+        sent = self.session.scp_send_fd(fd, OUT_FILE_PATH, 0640, len(FILE_CONTENT), chunk=4096)
+        self.assertEqual(sent, len(FILE_CONTENT))
+        self.assertEqual(os.lseek(fd, 0, os.SEEK_CUR), len(FILE_CONTENT))
+        os.close(fd)
+
+        self.assertEqual(stat.S_IMODE(os.stat(OUT_FILE_PATH).st_mode), 0640)
+        f = open(OUT_FILE_PATH, "r")
+        self.assertEqual(f.read(), FILE_CONTENT)
+        f.close()
+        os.remove(OUT_FILE_PATH)
+        os.remove(IN_FILE_PATH)
+
     def test_recv(self):
         # Initialize file that will be used
         IN_FILE_PATH = "/tmp/test_scp_test_recv_in"
@@ -98,6 +120,26 @@ class SCPTest(unittest.TestCase):
         if os.path.exists(IN_FILE_PATH):
             os.remove(IN_FILE_PATH)
 
+    def test_recv_fd(self):
+        IN_FILE_PATH = "/tmp/test_scp_recv_fd_in"
+        OUT_FILE_PATH = "/tmp/test_scp_recv_fd_out"
+        FILE_CONTENT = os.urandom(1024 * 1024 + 1)
+        f = open(IN_FILE_PATH, "w")
+        f.write(FILE_CONTENT)
+        f.close()
+        fd = os.open(OUT_FILE_PATH, os.O_RDWR | os.O_CREAT | os.O_TRUNC, 0644)
+        os.write(fd, "HEAD")
+        fileInfo = self.session.scp_recv_fd(IN_FILE_PATH, fd, 4096)
+        self.assertEqual(fileInfo['st_size'], len(FILE_CONTENT))
+        self.assertEqual(os.lseek(fd, 0, os.SEEK_CUR), len(FILE_CONTENT) + 4)
+        os.close(fd)
+
+        f = open(OUT_FILE_PATH, "r")
+        self.assertEqual(f.read(), "HEAD" + FILE_CONTENT)
+        f.close()
+        os.remove(OUT_FILE_PATH)
+        os.remove(IN_FILE_PATH)
+
     def tearDown(self):
         self.session.close()
         self.sock.close()
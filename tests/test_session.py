@@ -157,9 +157,95 @@ class SessionTest(unittest.TestCase):
         self.assertTrue(os.path.exists(OUT_FILE3))
         self.assertTrue(os.path.exists(OUT_FILE4))
         self.assertTrue(os.path.exists(OUT_FILE5))
+        # paths are quoted, and a failed move raises
+        SPECIAL = os.path.join(DIR1, "a b;$(true)")
+        open(SPECIAL, "w").close()
+        session.mv(SPECIAL, DIR2)
+        self.assertTrue(os.path.exists(os.path.join(DIR2, "a b;$(true)")))
+        self.assertRaises(libssh2.SessionException, session.mv, FILE1, DIR2)
         #
         session.close()
     
+    def test_poll(self):
+        session = libssh2.Session()
+        session.startup(self.sock)
+        username = pwd.getpwuid(os.getuid())[0]
+        session.userauth_agent(username)
+        self.assertEqual(session.userauth_authenticated(), 1)
+        #
+        channels = []
+        for i in range(0, 20):
+            channel = session.open_session()
+            channel.execute("echo -n %s; echo -n err 1>&2" % (i))
+            channels.append(channel)
+        outputs = dict((channel, "") for channel in channels)
+        pending = set(channels)
+        while pending:
+            for channel, revents in session.poll(list(pending), 1000):
+                if revents & libssh2.POLLFD_POLLEXT:
+                    self.assertEqual(str(channel.read_ex(1024, 1)[1]), "err")
+                if revents & libssh2.POLLFD_POLLIN:
+                    outputs[channel] += str(channel.read(1024))
+                if channel.eof():
+                    pending.discard(channel)
+        for i, channel in enumerate(channels):
+            self.assertEqual(outputs[channel], str(i))
+            session.channel_close(channel)
+        # nothing to wait for returns at once
+        self.assertEqual(session.poll([]), [])
+        #
+        session.close()
+
+    def test_run(self):
+        session = libssh2.Session()
+        session.startup(self.sock)
+        username = pwd.getpwuid(os.getuid())[0]
+        session.userauth_agent(username)
+        self.assertEqual(session.userauth_authenticated(), 1)
+        #
+        status, out, err, signal = session.run("echo -n out; echo -n err 1>&2; exit 3")
+        self.assertEqual((status, out, err, signal), (3, "out", "err", None))
+        # twice the 2 MB window on both streams, written before stdin is
+        # read: a driver writing all of stdin first would deadlock
+        size = 4 * 1024 * 1024
+        data = os.urandom(size)
+        status, out, err, signal = session.run("head -c %d /dev/zero; head -c %d /dev/zero 1>&2; cat"
+                                               % (size, size), data)
+        self.assertEqual(status, 0)
+        self.assertEqual(out, "\0" * size + data)
+        self.assertEqual(err, "\0" * size)
+        status, out, err, signal = session.run("kill -TERM $$")
+        self.assertEqual(signal, "TERM")
+        self.assertRaises(libssh2.Error, session.run, "sleep 10", None, 100)
+        # the session is still usable
+        self.assertEqual(session.run("true")[0], 0)
+        #
+        session.close()
+
+    def test_run_many(self):
+        session = libssh2.Session()
+        session.startup(self.sock)
+        username = pwd.getpwuid(os.getuid())[0]
+        session.userauth_agent(username)
+        self.assertEqual(session.userauth_authenticated(), 1)
+        #
+        ended = []
+        commands = ["echo -n %d" % (i) for i in range(50)] + [("cat", "in"), "exit 2"]
+        results = session.run_many(commands, 8, -1, lambda index, item: ended.append(index))
+        self.assertEqual(sorted(ended), range(len(commands)))
+        for i in range(50):
+            self.assertEqual(results[i], (0, str(i), "", None))
+        self.assertEqual(results[50], (0, "in", "", None))
+        self.assertEqual(results[51][0], 2)
+        # more channels than sshd allows (MaxSessions is 10 by default)
+        results = session.run_many(["sleep 0.1; echo -n ok"] * 30, 30)
+        self.assertEqual([result[1] for result in results], ["ok"] * 30)
+        results = session.run_many(["sleep 10", "true"], 2, 100)
+        self.assertTrue(isinstance(results[0], libssh2.Error))
+        self.assertEqual(results[1][0], 0)
+        #
+        session.close()
+
     def tearDown(self):
         self.sock.close()
 
@@ -9,7 +9,11 @@
 # Compile with:
 #
 import errno
+import hashlib
 import libssh2
+from libssh2 import metrics, tracing
+from libssh2.transfer import DOWNLOAD
+import mmap
 import os
 import pwd
 import shutil
@@ -76,11 +80,172 @@ class SFTPTest(unittest.TestCase):
         sftp.copy_file(FILE1, FILE2)
         self.assertTrue(os.path.exists(FILE1))
         self.assertTrue(os.path.exists(FILE2))
+        # a directory is not a destination, whichever way the copy goes
+        DIR = "/tmp/test_sftp_test_copy_file_dir"
+        os.mkdir(DIR)
+        self.assertRaises(IOError, sftp.copy_file, FILE1, DIR)
+        self.assertEqual(os.listdir(DIR), [])
+        os.rmdir(DIR)
+        os.remove(FILE2)
+        # an exec channel forced to sftp-server exits 0 and prints nothing
+        remote_command = sftp._remote_command
+        sftp._remote_command = lambda command: (0, "")
+        try:
+            sftp.copy_file(FILE1, FILE2)
+        finally:
+            sftp._remote_command = remote_command
+        self.assertTrue(os.path.exists(FILE2))
+        os.remove(FILE1)
+        os.remove(FILE2)
+        #
+        self.session.sftp_shutdown(sftp)
+
+    def test_copy_to(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        FILE1 = "/tmp/test_sftp_test_copy_to"
+        FILE2 = "/tmp/test_sftp_test_copy_to_newname"
+        CONTENT = os.urandom(3 * 1024 * 1024 + 17)
+        open(FILE1, "w").write(CONTENT)
+        src_file = sftp.open_file(FILE1, "r")
+        dst_file = sftp.open_file(FILE2, "w")
+        before = self.session.stats()["session"]
+        self.assertEqual(src_file.copy_to(dst_file), len(CONTENT))
+        # both sides on one session count as one call of the session
+        after = self.session.stats()["session"]
+        self.assertEqual(after["calls"] - before["calls"], 1)
+        self.assertEqual(after["bytes_read"] - before["bytes_read"], len(CONTENT))
+        self.assertEqual(after["bytes_written"] - before["bytes_written"], len(CONTENT))
+        sftp.close_file(src_file)
+        sftp.close_file(dst_file)
+        self.assertEqual(open(FILE2).read(), CONTENT)
         os.remove(FILE1)
         os.remove(FILE2)
         #
         self.session.sftp_shutdown(sftp)
 
+    def test_stats(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        FILE1 = "/tmp/test_sftp_test_stats"
+        CONTENT = os.urandom(64 * 1024)
+        before = self.session.stats()["session"]
+        file = sftp.open_file(FILE1, "w")
+        self.assertEqual(file.write(CONTENT), len(CONTENT))
+        self.assertEqual(file.stats()["bytes_written"], len(CONTENT))
+        self.assertEqual(file.stats()["calls"], 1)
+        stats = self.session.stats()
+        self.assertEqual(len(stats["files"]), 1)
+        self.assertEqual(stats["files"][0][1], file.stats())
+        self.assertEqual(len(stats["sftps"]), 1)
+        self.assertEqual(sftp.stats()["calls"], 1)
+        sftp.close_file(file)
+        after = self.session.stats()["session"]
+        self.assertEqual(after["bytes_written"] - before["bytes_written"], len(CONTENT))
+        self.assertEqual(after["calls"] - before["calls"], 2)
+        self.assertTrue(after["blocked_ns"] > before["blocked_ns"])
+        self.assertEqual(self.session.stats()["files"], [])
+        os.remove(FILE1)
+        #
+        self.session.sftp_shutdown(sftp)
+
+    def test_histograms(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        FILE1 = "/tmp/test_sftp_test_histograms"
+        open(FILE1, "w").write("x" * 1024)
+        metrics.reset()
+        previous = metrics.enable()
+        try:
+            for i in range(10):
+                sftp.get_stat(FILE1)
+            file = sftp.open_file(FILE1, "r")
+            self.assertEqual(file.read(1024), "x" * 1024)
+            file.seek(0)
+            self.assertEqual(file.read_pipelined(1024), "x" * 1024)
+            sftp.close_file(file)
+        finally:
+            metrics.enable(previous)
+        snapshot = metrics.histograms()
+        self.assertEqual(snapshot["stat"]["count"], 10)
+        self.assertEqual(sum(count for lower, upper, count in snapshot["stat"]["buckets"]), 10)
+        self.assertEqual(snapshot["sftp_open"]["count"], 1)
+        self.assertEqual(snapshot["read"]["count"], 1)
+        # whole transfers stay out of the single call latencies
+        self.assertEqual(snapshot["transfer"]["count"], 1)
+        self.assertTrue(0 < metrics.percentile("stat", 50, snapshot) <= metrics.percentile("stat", 99, snapshot))
+        text = metrics.prometheus_text(snapshot=snapshot)
+        self.assertTrue('libssh2_call_duration_seconds_count{op="stat"} 10\n' in text)
+        self.assertTrue('libssh2_call_duration_seconds_bucket{op="stat",le="+Inf"} 10\n' in text)
+        os.remove(FILE1)
+        #
+        self.session.sftp_shutdown(sftp)
+
+    def test_tracing(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        FILE1 = "/tmp/test_sftp_test_tracing"
+        CONTENT = "x" * 4096
+        batches = []
+        tracer = tracing.Tracer([batches.append], batch=2)
+        dropped = tracer.dropped
+        tracer.start()
+        try:
+            file = sftp.open_file(FILE1, "w")
+            file.write(CONTENT)
+            self.assertEqual(len(batches), 1)
+            sftp.close_file(file)
+            sftp.get_stat(FILE1)
+            try:
+                sftp.get_stat(FILE1 + ".missing")
+            except Exception:
+                pass
+        finally:
+            tracer.stop()
+        spans = sum(batches, [])
+        self.assertEqual([span.name for span in spans],
+                         ["libssh2.sftp_open", "libssh2.write", "libssh2.stat", "libssh2.stat"])
+        self.assertEqual([span.path for span in spans], [FILE1, FILE1, FILE1, FILE1 + ".missing"])
+        self.assertEqual(spans[1].object_id, file.stats()["id"])
+        self.assertEqual(spans[1].session_id, self.session.stats()["session"]["id"])
+        self.assertEqual(spans[1].bytes_written, len(CONTENT))
+        self.assertFalse(spans[2].error)
+        self.assertTrue(spans[3].error)
+        for span in spans:
+            self.assertTrue(span.start_time_unix_nano <= span.end_time_unix_nano)
+        self.assertEqual(tracer.dropped, dropped)
+        # OTLP JSON layout, with typed attribute values
+        otlp = spans[3].to_dict()
+        self.assertEqual(otlp["status"], {"code": tracing.STATUS_CODE_ERROR})
+        self.assertEqual(spans[2].to_dict()["status"], {"code": tracing.STATUS_CODE_UNSET})
+        attributes = dict((item["key"], item["value"]) for item in otlp["attributes"])
+        self.assertEqual(attributes["libssh2.path"], {"stringValue": FILE1 + ".missing"})
+        self.assertEqual(attributes["libssh2.rc"], {"intValue": str(spans[3].rc)})
+        # failed calls get the status given to the exporter
+        class OtelSpan(object):
+            def __init__(self):
+                self.status = None
+            def set_status(self, status):
+                self.status = status
+            def end(self, end_time=None):
+                pass
+        class OtelTracer(object):
+            def __init__(self):
+                self.spans = []
+            def start_span(self, name, start_time=None, attributes=None):
+                self.spans.append(OtelSpan())
+                return self.spans[-1]
+        otel_tracer = OtelTracer()
+        tracing.OpenTelemetryExporter(otel_tracer, "ERROR")(spans)
+        self.assertEqual([otel_span.status for otel_span in otel_tracer.spans], [None, None, None, "ERROR"])
+        os.remove(FILE1)
+        #
+        self.session.sftp_shutdown(sftp)
+
     def test_mkdir(self):
         sftp = self.session.sftp_init()
         self.assertTrue(sftp != None, "got an sftp object")
@@ -195,6 +360,35 @@ class SFTPTest(unittest.TestCase):
         #
         self.session.sftp_shutdown(sftp)
 
+    def test_stat_attributes(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        FILE = "/tmp/test_sftp_test_stat_attributes"
+        open(FILE, "w").close()
+        os.utime(FILE, (1000000000, 1200000000))
+        s1 = sftp.get_stat(FILE)
+        self.assertEqual(s1.st_size, s1['st_size'])
+        self.assertEqual(s1.st_mtime, 1200000000)
+        self.assertEqual(s1.get('st_atime'), 1000000000)
+        self.assertEqual(dict(s1), s1.to_dict())
+        self.assertEqual(sorted(s1.keys()), sorted(dict(s1).keys()))
+        # compared by value, with each other and with dicts
+        self.assertEqual(s1, sftp.get_stat(FILE))
+        self.assertEqual(s1, s1.to_dict())
+        self.assertEqual(s1.to_dict(), s1)
+        self.assertNotEqual(s1, sftp.get_stat("/tmp"))
+        # attributes feed back into set_stat
+        sftp.set_stat(FILE, {"st_atime": 1100000000, "st_mtime": 1300000000})
+        s2 = os.stat(FILE)
+        self.assertEqual(int(s2.st_atime), 1100000000)
+        self.assertEqual(int(s2.st_mtime), 1300000000)
+        sftp.set_stat(FILE, s1)
+        self.assertEqual(int(os.stat(FILE).st_mtime), 1200000000)
+        os.remove(FILE)
+        #
+        self.session.sftp_shutdown(sftp)
+
     def test_file_read(self):
         sftp = self.session.sftp_init()
         self.assertTrue(sftp != None, "got an sftp object")
@@ -352,6 +546,160 @@ class SFTPTest(unittest.TestCase):
         os.remove(FILE)
         self.session.sftp_shutdown(sftp)
 
+    def test_iter_entries(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        DIR = "/tmp/test_sftp_test_iter_entries"
+        LONG_NAME = "l" * 255
+        shutil.rmtree(DIR, ignore_errors=True)
+        os.mkdir(DIR)
+        names = set(["file%d" % i for i in range(1000)] + [LONG_NAME])
+        for name in names:
+            open(os.path.join(DIR, name), "w").close()
+        #
+        sftp_dir = sftp.open_dir(DIR)
+        listed = set()
+        for entries in sftp_dir.iter_entries(64):
+            self.assertTrue(0 < len(entries) <= 64)
+            for name, stat in entries:
+                listed.add(name)
+                self.assertTrue("st_size" in stat)
+        sftp.close_dir(sftp_dir)
+        self.assertEqual(listed - set([".", ".."]), names)
+        #
+        sftp_dir = sftp.open_dir(DIR)
+        self.assertTrue(LONG_NAME in sftp_dir.list_files())
+        sftp.close_dir(sftp_dir)
+        #
+        shutil.rmtree(DIR, ignore_errors=True)
+        self.session.sftp_shutdown(sftp)
+
+    def test_walk(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        DIR = "/tmp/test_sftp_test_walk"
+        shutil.rmtree(DIR, ignore_errors=True)
+        for i in range(10):
+            for j in range(5):
+                path = os.path.join(DIR, "d%d" % i, "e%d" % j)
+                os.makedirs(path)
+                for k in range(3):
+                    open(os.path.join(path, "f%d" % k), "w").close()
+        #
+        expected = {}
+        for dirpath, dirs, files in os.walk(DIR):
+            expected[dirpath] = (sorted(dirs), sorted(files))
+        walked = {}
+        for dirpath, dirs, files in sftp.walk(DIR, concurrency=4):
+            walked[dirpath] = (sorted(dirs), sorted(name for name, attrs in files))
+            for name, attrs in files:
+                self.assertEqual(attrs.st_size, 0)
+        self.assertEqual(walked, expected)
+        # pruning and errors
+        errors = []
+        walked = []
+        for dirpath, dirs, files in sftp.walk(DIR, concurrency=2):
+            walked.append(dirpath)
+            if dirpath == DIR:
+                dirs.remove("d0")
+        self.assertFalse(os.path.join(DIR, "d0") in walked)
+        self.assertEqual(len(walked), 1 + 9 + 9 * 5)
+        self.assertEqual(list(sftp.walk(DIR + "/missing", onerror=errors.append)), [])
+        self.assertEqual(len(errors), 1)
+        #
+        shutil.rmtree(DIR, ignore_errors=True)
+        self.session.sftp_shutdown(sftp)
+
+    def test_sync(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        LOCAL = "/tmp/test_sftp_test_sync_local"
+        REMOTE = "/tmp/test_sftp_test_sync_remote"
+        BACK = "/tmp/test_sftp_test_sync_back"
+        for path in (LOCAL, REMOTE, BACK):
+            shutil.rmtree(path, ignore_errors=True)
+        os.makedirs(os.path.join(LOCAL, "a", "b"))
+        for name in ("f1", "a/f2", "a/b/f3"):
+            f = open(os.path.join(LOCAL, name), "w")
+            f.write(name * 1000)
+            f.close()
+        #
+        report = sftp.sync(LOCAL, REMOTE)
+        self.assertEqual(len(report.results), 3)
+        self.assertEqual(report.errors, [])
+        self.assertEqual(open(os.path.join(REMOTE, "a/b/f3")).read(), "a/b/f3" * 1000)
+        self.assertEqual(int(os.stat(os.path.join(REMOTE, "f1")).st_mtime),
+                         int(os.stat(os.path.join(LOCAL, "f1")).st_mtime))
+        # unchanged tree, then one changed file
+        self.assertEqual(len(sftp.sync(LOCAL, REMOTE).results), 0)
+        f = open(os.path.join(LOCAL, "a/f2"), "a")
+        f.write("more")
+        f.close()
+        report = sftp.sync(LOCAL, REMOTE)
+        self.assertEqual([result.src for result in report.results], [os.path.join(LOCAL, "a/f2")])
+        #
+        report = sftp.sync(BACK, REMOTE, DOWNLOAD)
+        self.assertEqual(len(report.results), 3)
+        self.assertEqual(open(os.path.join(BACK, "a/f2")).read(), "a/f2" * 1000 + "more")
+        #
+        for path in (LOCAL, REMOTE, BACK):
+            shutil.rmtree(path, ignore_errors=True)
+        self.session.sftp_shutdown(sftp)
+
+    def test_put_delta(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        SRC = "/tmp/test_sftp_test_put_delta_src"
+        DST = "/tmp/test_sftp_test_put_delta_dst"
+        BLOCK = 64 * 1024
+        content = os.urandom(10 * BLOCK + 100)
+        open(SRC, "w").write(content)
+        if os.path.exists(DST):
+            os.remove(DST)
+        #
+        report = sftp.put_delta(SRC, DST, BLOCK)
+        self.assertEqual(report["changed"], 11)
+        self.assertEqual(open(DST).read(), content)
+        # two changed blocks and a shorter file
+        content = content[:3 * BLOCK] + "x" * BLOCK + content[4 * BLOCK:7 * BLOCK] + "y"
+        open(SRC, "w").write(content)
+        report = sftp.put_delta(SRC, DST, BLOCK)
+        self.assertEqual(report["changed"], 2)
+        self.assertEqual(report["bytes"], BLOCK + 1)
+        self.assertEqual(open(DST).read(), content)
+        self.assertEqual(sftp.put_delta(SRC, DST, BLOCK)["changed"], 0)
+        #
+        os.remove(SRC)
+        os.remove(DST)
+        self.session.sftp_shutdown(sftp)
+
+    def test_hash(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        FILES = ["/tmp/test_sftp_test_hash_%d" % i for i in range(12)]
+        contents = {}
+        for path in FILES:
+            contents[path] = os.urandom(100000)
+            open(path, "w").write(contents[path])
+        #
+        digests = sftp.hash_many(FILES, "sha256", max_channels=5)
+        for path in FILES:
+            self.assertEqual(digests[path], hashlib.sha256(contents[path]).hexdigest())
+        self.assertEqual(sftp.hash(FILES[0], "md5", 1000, 5000),
+                         hashlib.md5(contents[FILES[0]][1000:6000]).hexdigest())
+        # the SFTP fallback gives the same digest
+        self.assertEqual(sftp._local_hash(FILES[0], "sha1", 99000, None),
+                         hashlib.sha1(contents[FILES[0]][99000:]).hexdigest())
+        #
+        for path in FILES:
+            os.remove(path)
+        self.session.sftp_shutdown(sftp)
+
     def test_read(self):
         sftp = self.session.sftp_init()
         self.assertTrue(sftp != None, "got an sftp object")
@@ -370,6 +718,28 @@ class SFTPTest(unittest.TestCase):
         os.remove(FILE)
         self.session.sftp_shutdown(sftp)
 
+    def test_read_pipelined(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        FILE = "/tmp/test_sftp_test_read_pipelined"
+        CONTENT = os.urandom(5 * 1024 * 1024 + 17)
+        open(FILE, "w").write(CONTENT)
+        #
+        for depth in (1, 16):
+            sftp_file = sftp.open_file(FILE, "r")
+            # a partial read stops at total
+            head = sftp_file.read_pipelined(1024 * 1024 + 3, 30000, depth)
+            self.assertEqual(head, CONTENT[:1024 * 1024 + 3])
+            # the rest stops at end of file, then nothing is left
+            tail = sftp_file.read_pipelined(len(CONTENT), 30000, depth)
+            self.assertEqual(head + tail, CONTENT)
+            self.assertEqual(sftp_file.read_pipelined(1024, 30000, depth), "")
+            sftp.close_file(sftp_file)
+        #
+        os.remove(FILE)
+        self.session.sftp_shutdown(sftp)
+
     def test_write(self):
         sftp = self.session.sftp_init()
         self.assertTrue(sftp != None, "got an sftp object")
@@ -387,6 +757,48 @@ class SFTPTest(unittest.TestCase):
         os.remove(FILE)
         self.session.sftp_shutdown(sftp)
 
+    def test_readinto_write_buffer(self):
+        sftp = self.session.sftp_init()
+        self.assertTrue(sftp != None, "got an sftp object")
+        #
+        IN_FILE = "/tmp/test_sftp_test_readinto_in"
+        OUT_FILE = "/tmp/test_sftp_test_readinto_out"
+        CONTENT = "0123456789\n9876543210"
+        f = open(IN_FILE, "w")
+        f.write(CONTENT)
+        f.close()
+        #
+        array = bytearray(len(CONTENT))
+        view = memoryview(array)
+        sftp_file = sftp.open_file(IN_FILE, "r")
+        received = 0
+        while received < len(CONTENT):
+            rc = sftp_file.readinto(view[received:])
+            self.assertTrue(rc > 0)
+            received += rc
+        self.assertEqual(str(array), CONTENT)
+        sftp_file.seek(0)
+        buf = mmap.mmap(-1, len(CONTENT))
+        self.assertEqual(sftp_file.readinto(buf), len(CONTENT))
+        sftp.close_file(sftp_file)
+        self.assertEqual(buf[:], CONTENT)
+        #
+        sftp_file = sftp.open_file(OUT_FILE, "w", 0644)
+        sftp_file.write(buf)
+        sftp_file.write(memoryview(CONTENT)[10:])
+        # unicode is encoded like a "s#" argument, never written as UCS-2/4
+        sftp_file.write(u"unicode")
+        self.assertRaises(UnicodeError, sftp_file.write, u"\xe9")
+        sftp.close_file(sftp_file)
+        buf.close()
+        f = open(OUT_FILE)
+        self.assertEqual(f.read(), CONTENT + CONTENT[10:] + "unicode")
+        f.close()
+        #
+        os.remove(IN_FILE)
+        os.remove(OUT_FILE)
+        self.session.sftp_shutdown(sftp)
+
     def test_dir(self):
         sftp = self.session.sftp_init()
         self.assertTrue(sftp != None, "got an sftp object")
@@ -516,6 +928,37 @@ class SFTPTest(unittest.TestCase):
             os.remove(IN_FILE_PATH)
         self.session.sftp_shutdown(sftp)
 
+    def testPutPipelined(self):
+        IN_FILE_PATH = "/tmp/test_sftp_put_pipelined_in"
+        OUT_FILE_PATH = "/tmp/test_sftp_put_pipelined_out"
+        FILE_CONTENT = os.urandom(1024 * 1024 + 17)
+        #
+        sftp = self.session.sftp_init()
+        #
+        if os.path.exists(OUT_FILE_PATH):
+            os.remove(OUT_FILE_PATH)
+        f = open(IN_FILE_PATH, "w")
+        f.write(FILE_CONTENT)
+        f.close()
+        #
+        self.assertEqual(sftp.put(IN_FILE_PATH, OUT_FILE_PATH, pipeline_depth=8), len(FILE_CONTENT))
+        f = open(OUT_FILE_PATH, "r")
+        self.assertEqual(f.read(), FILE_CONTENT)
+        f.close()
+        #
+        fd = os.open(IN_FILE_PATH, os.O_RDONLY)
+        os.lseek(fd, 17, os.SEEK_SET)
+        self.assertEqual(sftp.put(fd, OUT_FILE_PATH, pipeline_depth=1), len(FILE_CONTENT) - 17)
+        self.assertEqual(os.lseek(fd, 0, os.SEEK_CUR), len(FILE_CONTENT))
+        os.close(fd)
+        f = open(OUT_FILE_PATH, "r")
+        self.assertEqual(f.read(), FILE_CONTENT[17:])
+        f.close()
+        #
+        os.remove(IN_FILE_PATH)
+        os.remove(OUT_FILE_PATH)
+        self.session.sftp_shutdown(sftp)
+
     def testGet(self):
         # Initialize file that will be used
         IN_FILE_PATH = "/tmp/test_sftp_get_in"